@@ -0,0 +1,300 @@
+/*
+ *
+ * Headless micro-benchmarks, no window or OpenGL context needed
+ * Build with -DCMAKE_BUILD_TYPE=Release for meaningful numbers
+ *
+ */
+
+#include "mc.h"
+
+#include <stdlib.h>
+#include <time.h>
+
+#define BENCH_CHUNKS  (16)
+#define BENCH_EDITS   (200000)
+#define BENCH_REPEATS (20)
+#define BENCH_RANGES  (4096) // live slot ranges, about a world of chunk meshes
+#define BENCH_OCCLUSION_CHUNKS (8) // along X and Z, 2 high like the world
+
+static double now (void) {
+    return (double)clock() / CLOCKS_PER_SEC;
+}
+
+static void generate (fnl_state * fnl, int cx, int cy, int cz, MC_BOOL morton, mc_BlockID * ids) {
+    for (int x = 0; x < MC_CHUNK_SIZE; x++)
+    for (int y = 0; y < MC_CHUNK_SIZE; y++)
+    for (int z = 0; z < MC_CHUNK_SIZE; z++) {
+        float noise = fnlGetNoise3D(fnl, cx * MC_CHUNK_SIZE + x, cy * MC_CHUNK_SIZE + y, cz * MC_CHUNK_SIZE + z);
+        uint32_t i = morton ? mc_chunk_idx_morton(x, y, z) : mc_chunk_idx_linear(x, y, z);
+        ids[i] = (noise > 0.0f) ? MC_BLOCK_TYPE_GRASS : MC_BLOCK_TYPE_NONE;
+    }
+}
+
+/*============================================================================================================
+ *
+ * Workloads
+ * `morton` is always a constant at the call site, the branches on it get folded away
+ * Neighbours are found with mc_chunk_idx_step in both layouts
+ *
+ *==========================================================================================================*/
+
+static inline uint32_t idx (MC_BOOL morton, int x, int y, int z) {
+    return morton ? mc_chunk_idx_morton(x, y, z) : mc_chunk_idx_linear(x, y, z);
+}
+
+static inline uint32_t axis_mask (MC_BOOL morton, int face) {
+    static const uint32_t masks[2][3] = {
+        {MC_CHUNK_LINEAR_MASK_X, MC_CHUNK_LINEAR_MASK_Y, MC_CHUNK_LINEAR_MASK_Z},
+        {MC_CHUNK_MORTON_MASK_X, MC_CHUNK_MORTON_MASK_Y, MC_CHUNK_MORTON_MASK_Z}
+    };
+    return masks[morton != 0][face / 2];
+}
+
+static inline int exposed_faces (const struct mc_Chunk * chunk, MC_BOOL morton, uint32_t i) {
+    if (!MC_BLOCK_EXISTS(mc_chunk_get(chunk, i)))
+        return 0;
+    int n = 0;
+    for (int f = 0; f < MC_BLOCK_FACES; f++) {
+        uint32_t ni;
+        if (!mc_chunk_idx_step(i, axis_mask(morton, f), (f & 1) ? 1 : -1, &ni))
+            n++;
+        else if (!MC_BLOCK_EXISTS(mc_chunk_get(chunk, ni)))
+            n++;
+    }
+    return n;
+}
+
+// every block in storage order, like mc_world_mesh_chunk
+static long mesh (struct mc_Chunk ** chunks, MC_BOOL morton) {
+    long faces = 0;
+    for (int c = 0; c < BENCH_CHUNKS; c++)
+    for (uint32_t i = 0; i < MC_CHUNK_BLOCKS; i++)
+        faces += exposed_faces(chunks[c], morton, i);
+    return faces;
+}
+
+// the same faces from the occupancy bits, a slice at a time
+static long mesh_occupancy (struct mc_Chunk ** chunks) {
+    static const struct mc_Chunk * const none[MC_BLOCK_FACES] = {NULL};
+    uint32_t exposed[MC_BLOCK_FACES][MC_CHUNK_SIZE];
+    long faces = 0;
+    for (int c = 0; c < BENCH_CHUNKS; c++)
+    for (int x = 0; x < MC_CHUNK_SIZE; x++) {
+        mc_chunk_exposed_faces(chunks[c], none, x, exposed);
+        for (int f = 0; f < MC_BLOCK_FACES; f++)
+        for (int y = 0; y < MC_CHUNK_SIZE; y++)
+            faces += __builtin_popcount(exposed[f][y]);
+    }
+    return faces;
+}
+
+// whole chunks through mc_mesh_build, face records and all
+static long mesh_binary (struct mc_Chunk ** chunks, MC_BOOL greedy) {
+    static const struct mc_ChunkBorders none = {0};
+    struct mc_Mesh m;
+    mc_mesh_init(&m);
+    long faces = 0;
+    for (int c = 0; c < BENCH_CHUNKS; c++) {
+        mc_mesh_build(&m, chunks[c], &none, greedy);
+        faces += m.faces;
+    }
+    mc_mesh_free(&m);
+    return faces;
+}
+
+// toggle a block, then re-evaluate the faces of it and its 6 neighbours, like set_block_at
+static long place_destroy (struct mc_Chunk ** chunks, MC_BOOL morton, const uint32_t * edits) {
+    long faces = 0;
+    for (int e = 0; e < BENCH_EDITS; e++) {
+        struct mc_Chunk * chunk = chunks[edits[e] % BENCH_CHUNKS];
+        int x = (edits[e] >> 4)  & (MC_CHUNK_SIZE - 1);
+        int y = (edits[e] >> 9)  & (MC_CHUNK_SIZE - 1);
+        int z = (edits[e] >> 14) & (MC_CHUNK_SIZE - 1);
+        uint32_t i = idx(morton, x, y, z);
+        mc_chunk_set(chunk, i, MC_BLOCK_EXISTS(mc_chunk_get(chunk, i)) ? MC_BLOCK_TYPE_NONE : MC_BLOCK_TYPE_GRASS);
+        faces += exposed_faces(chunk, morton, i);
+        for (int f = 0; f < MC_BLOCK_FACES; f++) {
+            uint32_t ni;
+            if (mc_chunk_idx_step(i, axis_mask(morton, f), (f & 1) ? 1 : -1, &ni))
+                faces += exposed_faces(chunk, morton, ni);
+        }
+    }
+    return faces;
+}
+
+// a chunk is remeshed: its range is given back and one of another size is taken, like the world VBO does
+static long slots_churn (struct mc_Slots * slots, uint32_t (*ranges)[2], const uint32_t * edits) {
+    long taken = 0;
+    for (int e = 0; e < BENCH_EDITS; e++) {
+        uint32_t * range = ranges[edits[e] % BENCH_RANGES];
+        mc_slots_release(slots, range[0], range[1]);
+        range[1] = 1 + ((edits[e] >> 12) & 0xfff) * ((edits[e] >> 24) & 3); // mostly small, sometimes 12K faces
+        range[0] = mc_slots_find(slots, range[1]);
+        mc_slots_take(slots, range[0], range[1]);
+        taken += range[1];
+    }
+    return taken;
+}
+
+/*============================================================================================================
+ *
+ *
+ *
+ *==========================================================================================================*/
+
+static void bench_layout (const char * name, MC_BOOL morton, const uint32_t * edits) {
+    fnl_state fnl = fnlCreateState();
+    fnl.noise_type = FNL_NOISE_PERLIN;
+
+    static mc_BlockID ids[MC_CHUNK_BLOCKS];
+    struct mc_Chunk * chunks[BENCH_CHUNKS];
+    for (int c = 0; c < BENCH_CHUNKS; c++) {
+        chunks[c] = mc_chunk_create(c, 0, 0);
+        generate(&fnl, c, c & 1, 0, morton, ids);
+        mc_chunk_fill(chunks[c], ids);
+    }
+
+    double t = now();
+    long faces = 0;
+    for (int r = 0; r < BENCH_REPEATS; r++)
+        faces += mesh(chunks, morton);
+    double t_mesh = now() - t;
+
+    t = now();
+    long bit_faces = 0;
+    // the occupancy always follows the compiled in layout (MC_CHUNK_MORTON)
+    if (morton == MC_CHUNK_MORTON)
+        for (int r = 0; r < BENCH_REPEATS; r++)
+            bit_faces += mesh_occupancy(chunks);
+    double t_bits = now() - t;
+
+    double t_binary[2] = {0.0, 0.0};
+    long binary_faces[2] = {0, 0};
+    for (int g = 0; (morton == MC_CHUNK_MORTON) && (g < 2); g++) {
+        t = now();
+        for (int r = 0; r < BENCH_REPEATS; r++)
+            binary_faces[g] += mesh_binary(chunks, g);
+        t_binary[g] = now() - t;
+    }
+
+    t = now();
+    long edit_faces = 0;
+    for (int r = 0; r < BENCH_REPEATS; r++)
+        edit_faces += place_destroy(chunks, morton, edits);
+    double t_edit = now() - t;
+
+    printf("%-8s mesh          : %8.2f us / chunk (%ld faces)\n", name, t_mesh * 1e6 / (BENCH_REPEATS * BENCH_CHUNKS), faces / BENCH_REPEATS);
+    if (morton == MC_CHUNK_MORTON)
+        printf("%-8s mesh (bits)   : %8.2f us / chunk (%ld faces)\n", name, t_bits * 1e6 / (BENCH_REPEATS * BENCH_CHUNKS), bit_faces / BENCH_REPEATS);
+    if (morton == MC_CHUNK_MORTON) {
+        printf("%-8s mesh (binary) : %8.2f us / chunk (%ld faces)\n", name, t_binary[0] * 1e6 / (BENCH_REPEATS * BENCH_CHUNKS), binary_faces[0] / BENCH_REPEATS);
+        printf("%-8s mesh (greedy) : %8.2f us / chunk (%ld faces)\n", name, t_binary[1] * 1e6 / (BENCH_REPEATS * BENCH_CHUNKS), binary_faces[1] / BENCH_REPEATS);
+    }
+    printf("%-8s place/destroy : %8.2f ns / edit  (%ld faces)\n", name, t_edit * 1e9 / (BENCH_REPEATS * BENCH_EDITS), edit_faces / BENCH_REPEATS);
+
+    for (int c = 0; c < BENCH_CHUNKS; c++)
+        mc_chunk_destroy(chunks[c]);
+}
+
+static void bench_slots (const uint32_t * edits) {
+    struct mc_Slots slots;
+    mc_slots_init(&slots);
+    uint32_t (*ranges)[2] = malloc(sizeof(*ranges) * BENCH_RANGES);
+    assert(ranges != NULL);
+    uint64_t live = 0;
+    for (int i = 0; i < BENCH_RANGES; i++) {
+        ranges[i][1] = 1 + (edits[i] & 0xfff);
+        ranges[i][0] = mc_slots_find(&slots, ranges[i][1]);
+        mc_slots_take(&slots, ranges[i][0], ranges[i][1]);
+    }
+
+    double t = now();
+    for (int r = 0; r < BENCH_REPEATS; r++)
+        slots_churn(&slots, ranges, edits);
+    double t_churn = now() - t;
+
+    for (int i = 0; i < BENCH_RANGES; i++)
+        live += ranges[i][1];
+    printf("slots    churn         : %8.2f ns / range (%u top, %.1f%% live)\n", t_churn * 1e9 / (BENCH_REPEATS * BENCH_EDITS), slots.top, live * 100.0 / slots.top);
+
+    free(ranges);
+    mc_slots_free(&slots);
+}
+
+// the chunks around the one the camera is in rasterized as occluders, then every chunk tested, for 4 directions
+static void bench_occlusion (void) {
+    fnl_state fnl = fnlCreateState();
+    fnl.noise_type = FNL_NOISE_PERLIN;
+
+    static mc_BlockID ids[MC_CHUNK_BLOCKS];
+    enum { N = BENCH_OCCLUSION_CHUNKS * 2 * BENCH_OCCLUSION_CHUNKS };
+    struct mc_Chunk * chunks[N];
+    for (int i = 0; i < N; i++) {
+        int cx = i % BENCH_OCCLUSION_CHUNKS, cy = i / BENCH_OCCLUSION_CHUNKS % 2, cz = i / BENCH_OCCLUSION_CHUNKS / 2;
+        chunks[i] = mc_chunk_create(cx, cy, cz);
+        generate(&fnl, cx, cy, cz, MC_CHUNK_MORTON, ids);
+        mc_chunk_fill(chunks[i], ids);
+        chunks[i]->solid_cells = mc_chunk_solid_cells(chunks[i]);
+    }
+
+    static struct mc_Occlusion occ;
+    mc_occlusion_init(&occ);
+    const float size = MC_CHUNK_SIZE * MC_BLOCK_SIZE;
+    int cam = BENCH_OCCLUSION_CHUNKS / 2;
+    vec3 eye = {(cam + 0.5f) * size, size, (cam + 0.5f) * size};
+    mat4 proj;
+    glm_perspective(glm_rad(MC_FOV), (float)MC_WINDOW_WIDTH / (float)MC_WINDOW_HEIGHT, 0.1f, 1000.0f, proj);
+
+    double t_raster = 0.0, t_test = 0.0;
+    long occluders = 0, occluded = 0;
+    for (int r = 0; r < BENCH_REPEATS; r++)
+    for (int d = 0; d < 4; d++) {
+        mat4 view, viewproj;
+        vec3 center = {eye[0] + ((d == 0) ? 1.0f : (d == 1) ? -1.0f : 0.0f), eye[1], eye[2] + ((d == 2) ? 1.0f : (d == 3) ? -1.0f : 0.0f)};
+        glm_lookat(eye, center, (vec3){0, 1, 0}, view);
+        glm_mat4_mul(proj, view, viewproj);
+
+        double t = now();
+        mc_occlusion_begin(&occ, viewproj, eye);
+        for (int i = 0; i < N; i++)
+            if ((abs(chunks[i]->pos[0] - cam) <= MC_WORLD_OCCLUDER_RANGE) && (abs(chunks[i]->pos[2] - cam) <= MC_WORLD_OCCLUDER_RANGE))
+                mc_occlusion_add_chunk(&occ, chunks[i]);
+        mc_occlusion_finish(&occ);
+        t_raster += now() - t;
+        occluders += occ.occluders;
+
+        t = now();
+        for (int i = 0; i < N; i++) {
+            vec3 min = {chunks[i]->pos[0] * size, chunks[i]->pos[1] * size, chunks[i]->pos[2] * size}, max;
+            glm_vec3_adds(min, size, max);
+            occluded += !mc_occlusion_visible(&occ, min, max);
+        }
+        t_test += now() - t;
+    }
+    int frames = BENCH_REPEATS * 4;
+    printf("occlusion raster       : %8.2f us / frame (%ld boxes)\n", t_raster * 1e6 / frames, occluders / frames);
+    printf("occlusion test         : %8.2f ns / chunk (%ld of %d occluded)\n", t_test * 1e9 / (frames * N), occluded / frames, N);
+
+    mc_occlusion_free(&occ);
+    for (int i = 0; i < N; i++)
+        mc_chunk_destroy(chunks[i]);
+}
+
+int main (void) {
+    uint32_t * edits = malloc(sizeof(*edits) * BENCH_EDITS);
+    assert(edits != NULL);
+    srand(1);
+    for (int e = 0; e < BENCH_EDITS; e++)
+        edits[e] = ((uint32_t)rand() << 15) ^ (uint32_t)rand();
+
+    puts("chunk block layout");
+    bench_layout("linear", MC_FALSE, edits);
+    bench_layout("morton", MC_TRUE,  edits);
+    puts("face slots");
+    bench_slots(edits);
+    puts("occlusion culling");
+    bench_occlusion();
+
+    free(edits);
+    return 0;
+}
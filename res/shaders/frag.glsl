@@ -1,9 +1,9 @@
 #version 330 core
 out vec4 FragColor;
 
-in vec2 TexCoord;
+in vec3 TexCoord;
 in float alpha;
-uniform sampler2D tex;
+uniform sampler2DArray tex;
 
 void main()
 {
@@ -1,15 +1,56 @@
 #version 330 core
-layout (location = 0) in vec3 aPos;
-layout (location = 1) in vec2 aTexCoord;
-layout (location = 2) in float aAlpha;
+layout (location = 0) in uint aData; // see mc_BlockVertex, unused when pulling
 
 out float alpha;
-out vec2 TexCoord;
+out vec3 TexCoord;
 uniform mat4 proj, view;
+uniform ivec3 origin; // of the chunk, in blocks
+uniform float blockSize;
+uniform float translucentAlpha;
+uniform bool pulling; // the vertices come from the face records in `faces`, see mc_FaceRecord
+uniform usamplerBuffer faces;
+
+// same as face_corners in mesh.c
+const vec3 corners[24] = vec3[24](
+   vec3(0,1,1), vec3(0,1,0), vec3(0,0,0), vec3(0,0,1), // left
+   vec3(1,0,0), vec3(1,1,0), vec3(1,1,1), vec3(1,0,1), // right
+   vec3(0,0,0), vec3(1,0,0), vec3(1,0,1), vec3(0,0,1), // bottom
+   vec3(1,1,1), vec3(1,1,0), vec3(0,1,0), vec3(0,1,1), // top
+   vec3(1,1,0), vec3(1,0,0), vec3(0,0,0), vec3(0,1,0), // back
+   vec3(0,0,1), vec3(1,0,1), vec3(1,1,1), vec3(0,1,1)  // front
+);
+
+vec3 unpack (uint v) {
+   return vec3(v & 63u, (v >> 6) & 63u, (v >> 12) & 63u);
+}
 
 void main()
 {
-   gl_Position = proj * view * vec4(aPos.x, aPos.y, aPos.z, 1.0f);
-   TexCoord = aTexCoord;
-   alpha = aAlpha;
-}
\ No newline at end of file
+   uint data;
+   vec3 local;
+   if (pulling) {
+      uvec2 record = texelFetch(faces, gl_VertexID / 4).rg;
+      data = record.r;
+      local = unpack(data) + corners[int((data >> 18) & 7u) * 4 + gl_VertexID % 4] * unpack(record.g);
+   }
+   else {
+      data = aData;
+      local = unpack(data);
+   }
+   uint face = (data >> 18) & 7u;
+   float layer = float((data >> 21) & 255u);
+   uint flags = data >> 29;
+
+   gl_Position = proj * view * vec4((vec3(origin) + local) * blockSize, 1.0f);
+
+   // the texture repeats once per block, v runs backwards along Z on the top and bottom faces
+   vec2 uv;
+   if (face < 2u)
+      uv = local.zy;
+   else if (face < 4u)
+      uv = vec2(local.x, -local.z);
+   else
+      uv = local.xy;
+   TexCoord = vec3(uv, layer);
+   alpha = ((flags & 1u) != 0u) ? translucentAlpha : 1.0f;
+}
@@ -0,0 +1,485 @@
+#include "mc.h"
+
+#include <stdlib.h>
+
+#define MC_OCCUPANCY_ROWS (MC_CHUNK_SIZE * MC_CHUNK_SIZE)
+#define REP4(x) x, x, x, x
+
+const uint64_t mc_chunk_uniform_data[MC_CHUNK_BLOCKS / 64] = {0};
+const uint32_t mc_chunk_occupancy_empty[MC_OCCUPANCY_ROWS] = {0};
+const uint32_t mc_chunk_occupancy_full[MC_OCCUPANCY_ROWS] = { REP4(REP4(REP4(REP4(REP4(0xFFFFFFFFu))))) };
+
+static inline size_t data_words (uint8_t bits_log2) {
+    return ((size_t)MC_CHUNK_BLOCKS << bits_log2) / 64;
+}
+
+static inline size_t palette_cap (uint8_t bits_log2) {
+    return (size_t)1 << (1u << bits_log2);
+}
+
+// smallest index width that can address `len` palette entries
+static inline uint8_t bits_log2_for (uint32_t len) {
+    uint8_t bits_log2 = 0;
+    while (palette_cap(bits_log2) < len)
+        bits_log2++;
+    assert(bits_log2 <= MC_CHUNK_MAX_BITS_LOG2);
+    return bits_log2;
+}
+
+static void free_data (struct mc_Chunk * chunk) {
+    assert(chunk != NULL);
+    if (!mc_chunk_is_uniform(chunk)) {
+        free(chunk->data);
+        free(chunk->occupancy);
+    }
+}
+
+static void make_uniform (struct mc_Chunk * chunk) {
+    assert(chunk != NULL);
+    chunk->bits_log2 = 0;
+    chunk->data = (uint64_t *)mc_chunk_uniform_data;
+    chunk->occupancy = (uint32_t *)(MC_BLOCK_OPAQUE(chunk->palette[0]) ? mc_chunk_occupancy_full : mc_chunk_occupancy_empty);
+}
+
+// copy on write
+static void make_private (struct mc_Chunk * chunk) {
+    assert(chunk != NULL);
+    assert(mc_chunk_is_uniform(chunk));
+    const uint32_t * occupancy = chunk->occupancy;
+    chunk->data = calloc(data_words(chunk->bits_log2), sizeof(*chunk->data));
+    chunk->occupancy = malloc(sizeof(*chunk->occupancy) * MC_OCCUPANCY_ROWS);
+    assert(chunk->data != NULL);
+    assert(chunk->occupancy != NULL);
+    memcpy(chunk->occupancy, occupancy, sizeof(*chunk->occupancy) * MC_OCCUPANCY_ROWS);
+}
+
+// re-packs the indices with a new width, dropping the free palette entries
+// a chunk left with a single palette entry becomes uniform
+static void repack (struct mc_Chunk * chunk, uint8_t bits_log2) {
+    assert(chunk != NULL);
+    assert(bits_log2 <= MC_CHUNK_MAX_BITS_LOG2);
+    assert(palette_cap(bits_log2) >= chunk->palette_used);
+
+    size_t cap = palette_cap(bits_log2);
+    mc_BlockID * palette = malloc(sizeof(*palette) * cap);
+    uint16_t * refs = malloc(sizeof(*refs) * cap);
+    uint16_t * remap = malloc(sizeof(*remap) * chunk->palette_len);
+    assert(palette != NULL);
+    assert(refs != NULL);
+    assert(remap != NULL);
+    uint32_t len = 0;
+    for (uint32_t p = 0; p < chunk->palette_len; p++) {
+        if (chunk->palette_refs[p] == 0)
+            continue;
+        remap[p] = len;
+        palette[len] = chunk->palette[p];
+        refs[len] = chunk->palette_refs[p];
+        len++;
+    }
+
+    struct mc_Chunk old = *chunk;
+    chunk->palette = palette;
+    chunk->palette_refs = refs;
+    chunk->palette_len = len;
+    if (len == 1) {
+        assert(bits_log2 == 0);
+        make_uniform(chunk);
+        free_data(&old);
+    }
+    else {
+        // the occupancy doesn't change, keep it
+        chunk->bits_log2 = bits_log2;
+        chunk->data = calloc(data_words(bits_log2), sizeof(*chunk->data));
+        assert(chunk->data != NULL);
+        for (uint32_t i = 0; i < MC_CHUNK_BLOCKS; i++)
+            mc_chunk_set_palette_idx(chunk, i, remap[mc_chunk_palette_idx(&old, i)]);
+        free(old.data);
+    }
+
+    free(old.palette);
+    free(old.palette_refs);
+    free(remap);
+}
+
+/*============================================================================================================
+ *
+ *
+ *
+ *==========================================================================================================*/
+
+struct mc_Chunk * mc_chunk_create (int cx, int cy, int cz) {
+    struct mc_Chunk * chunk = malloc(sizeof(*chunk));
+    assert(chunk != NULL);
+    chunk->pos[0] = cx;
+    chunk->pos[1] = cy;
+    chunk->pos[2] = cz;
+    chunk->palette = malloc(sizeof(*chunk->palette) * palette_cap(0));
+    chunk->palette_refs = malloc(sizeof(*chunk->palette_refs) * palette_cap(0));
+    assert(chunk->palette != NULL);
+    assert(chunk->palette_refs != NULL);
+    chunk->palette[0] = MC_BLOCK_TYPE_NONE;
+    chunk->palette_refs[0] = MC_CHUNK_BLOCKS;
+    chunk->palette_len = 1;
+    chunk->palette_used = 1;
+    make_uniform(chunk);
+    chunk->mesh_first = 0;
+    chunk->mesh_faces = 0;
+    memset(chunk->mesh_dir_faces, 0, sizeof(chunk->mesh_dir_faces));
+    chunk->mesh_translucent = 0;
+    chunk->mesh_cap = 0;
+    chunk->dirty = MC_FALSE;
+    chunk->version = 0;
+    chunk->meshing = 0;
+    chunk->solid_cells = 0;
+    memset(chunk->links, (1 << MC_BLOCK_FACES) - 1, sizeof(chunk->links)); // open until it's meshed
+    chunk->visit = 0;
+    return chunk;
+}
+
+// a copy of the blocks that can be read while the original changes, uniform chunks still share their data
+struct mc_Chunk * mc_chunk_clone (const struct mc_Chunk * chunk) {
+    assert(chunk != NULL);
+    struct mc_Chunk * copy = malloc(sizeof(*copy));
+    assert(copy != NULL);
+    *copy = *chunk;
+    size_t cap = palette_cap(chunk->bits_log2);
+    copy->palette = malloc(sizeof(*copy->palette) * cap);
+    copy->palette_refs = malloc(sizeof(*copy->palette_refs) * cap);
+    assert(copy->palette != NULL);
+    assert(copy->palette_refs != NULL);
+    memcpy(copy->palette, chunk->palette, sizeof(*copy->palette) * chunk->palette_len);
+    memcpy(copy->palette_refs, chunk->palette_refs, sizeof(*copy->palette_refs) * chunk->palette_len);
+    if (!mc_chunk_is_uniform(chunk)) {
+        copy->data = malloc(sizeof(*copy->data) * data_words(chunk->bits_log2));
+        copy->occupancy = malloc(sizeof(*copy->occupancy) * MC_OCCUPANCY_ROWS);
+        assert(copy->data != NULL);
+        assert(copy->occupancy != NULL);
+        memcpy(copy->data, chunk->data, sizeof(*copy->data) * data_words(chunk->bits_log2));
+        memcpy(copy->occupancy, chunk->occupancy, sizeof(*copy->occupancy) * MC_OCCUPANCY_ROWS);
+    }
+    return copy;
+}
+
+void mc_chunk_destroy (struct mc_Chunk * chunk) {
+    assert(chunk != NULL);
+    free(chunk->palette);
+    free(chunk->palette_refs);
+    free_data(chunk);
+    free(chunk);
+}
+
+size_t mc_chunk_memory (const struct mc_Chunk * chunk) {
+    assert(chunk != NULL);
+    size_t mem = palette_cap(chunk->bits_log2) * (sizeof(*chunk->palette) + sizeof(*chunk->palette_refs));
+    if (!mc_chunk_is_uniform(chunk)) {
+        mem += data_words(chunk->bits_log2) * sizeof(*chunk->data);
+        mem += MC_OCCUPANCY_ROWS * sizeof(*chunk->occupancy);
+    }
+    return mem;
+}
+
+// replaces all the blocks of a chunk, ids is indexed with mc_chunk_idx
+void mc_chunk_fill (struct mc_Chunk * chunk, const mc_BlockID * ids) {
+    assert(chunk != NULL);
+    assert(ids != NULL);
+
+    free_data(chunk);
+    chunk->palette_len = 0;
+    chunk->palette_used = 0;
+    chunk->bits_log2 = 0;
+
+    // build the palette first, most chunks end up uniform and never need an index array
+    static const size_t max_cap = (size_t)1 << (1u << MC_CHUNK_MAX_BITS_LOG2);
+    uint32_t last = 0;
+    for (uint32_t i = 0; i < MC_CHUNK_BLOCKS; i++) {
+        if ((chunk->palette_len > 0) && (chunk->palette[last] == ids[i])) {
+            chunk->palette_refs[last]++;
+            continue;
+        }
+        uint32_t p = 0;
+        while ((p < chunk->palette_len) && (chunk->palette[p] != ids[i]))
+            p++;
+        if (p == chunk->palette_len) {
+            assert(p < max_cap);
+            if (p == palette_cap(chunk->bits_log2)) {
+                chunk->bits_log2++;
+                chunk->palette = realloc(chunk->palette, sizeof(*chunk->palette) * palette_cap(chunk->bits_log2));
+                chunk->palette_refs = realloc(chunk->palette_refs, sizeof(*chunk->palette_refs) * palette_cap(chunk->bits_log2));
+                assert(chunk->palette != NULL);
+                assert(chunk->palette_refs != NULL);
+            }
+            chunk->palette[p] = ids[i];
+            chunk->palette_refs[p] = 0;
+            chunk->palette_len++;
+        }
+        chunk->palette_refs[p]++;
+        last = p;
+    }
+    chunk->palette_used = chunk->palette_len;
+    if (chunk->palette_len == 1) {
+        make_uniform(chunk);
+        return;
+    }
+
+    chunk->data = calloc(data_words(chunk->bits_log2), sizeof(*chunk->data));
+    chunk->occupancy = calloc(MC_OCCUPANCY_ROWS, sizeof(*chunk->occupancy));
+    assert(chunk->data != NULL);
+    assert(chunk->occupancy != NULL);
+    last = 0;
+    for (uint32_t i = 0; i < MC_CHUNK_BLOCKS; i++) {
+        if (chunk->palette[last] != ids[i]) {
+            last = 0;
+            while (chunk->palette[last] != ids[i])
+                last++;
+        }
+        mc_chunk_set_palette_idx(chunk, i, last);
+        if (MC_BLOCK_OPAQUE(ids[i]))
+            mc_chunk_set_occupied(chunk, i, MC_TRUE);
+    }
+}
+
+// mc_chunk_set when the palette has to change
+void mc_chunk_set_slow (struct mc_Chunk * chunk, uint32_t idx, mc_BlockID id) {
+    assert(chunk != NULL);
+    assert(idx < MC_CHUNK_BLOCKS);
+
+    uint32_t old = mc_chunk_palette_idx(chunk, idx);
+    if (chunk->palette[old] == id)
+        return;
+
+    if (mc_chunk_is_uniform(chunk))
+        make_private(chunk);
+
+    uint32_t p = UINT32_MAX;
+    uint32_t free_p = UINT32_MAX;
+    for (uint32_t i = 0; i < chunk->palette_len; i++) {
+        if (chunk->palette_refs[i] == 0) {
+            if (free_p == UINT32_MAX)
+                free_p = i;
+        }
+        else if (chunk->palette[i] == id) {
+            p = i;
+            break;
+        }
+    }
+    if (p == UINT32_MAX) {
+        if (free_p != UINT32_MAX)
+            p = free_p;
+        else {
+            if (chunk->palette_len == palette_cap(chunk->bits_log2)) {
+                repack(chunk, chunk->bits_log2 + 1);
+                old = mc_chunk_palette_idx(chunk, idx);
+            }
+            p = chunk->palette_len++;
+        }
+        chunk->palette[p] = id;
+        chunk->palette_refs[p] = 0;
+        chunk->palette_used++;
+    }
+
+    mc_chunk_set_palette_idx(chunk, idx, p);
+    mc_chunk_set_occupied(chunk, idx, MC_BLOCK_OPAQUE(id));
+    chunk->palette_refs[p]++;
+    if (--chunk->palette_refs[old] == 0) {
+        chunk->palette_used--;
+        uint8_t bits_log2 = bits_log2_for(chunk->palette_used);
+        if ((bits_log2 < chunk->bits_log2) || (chunk->palette_used == 1))
+            repack(chunk, bits_log2);
+    }
+}
+
+/*
+ * Exposed faces of every block in the slice at local x, as bit rows along Z (same layout as the occupancy):
+ * bit z of faces[f][y] is set if the block (x, y, z) is opaque and its neighbour in the direction f isn't.
+ * Blocks in missing (NULL) neighbour chunks count as empty.
+ * The inner loop is plain bitwise arithmetic over 32 rows so the compiler can vectorize it.
+ */
+void mc_chunk_exposed_faces (const struct mc_Chunk * chunk, const struct mc_Chunk * const neighbours[MC_BLOCK_FACES], int x, uint32_t faces[MC_BLOCK_FACES][MC_CHUNK_SIZE]) {
+    assert(chunk != NULL);
+    assert(neighbours != NULL);
+    assert((x >= 0) && (x < MC_CHUNK_SIZE));
+
+    const struct mc_Chunk * left   = neighbours[MC_BLOCK_FACE_LEFT];
+    const struct mc_Chunk * right  = neighbours[MC_BLOCK_FACE_RIGHT];
+    const struct mc_Chunk * bottom = neighbours[MC_BLOCK_FACE_BOTTOM];
+    const struct mc_Chunk * top    = neighbours[MC_BLOCK_FACE_TOP];
+    const struct mc_Chunk * back   = neighbours[MC_BLOCK_FACE_BACK];
+    const struct mc_Chunk * front  = neighbours[MC_BLOCK_FACE_FRONT];
+
+    const uint32_t * mid = &chunk->occupancy[x << MC_CHUNK_SIZE_LOG2];
+    const uint32_t * lft =
+        (x > 0)        ? &chunk->occupancy[(x - 1) << MC_CHUNK_SIZE_LOG2] :
+        (left != NULL) ? &left->occupancy[(MC_CHUNK_SIZE - 1) << MC_CHUNK_SIZE_LOG2] :
+                         mc_chunk_occupancy_empty;
+    const uint32_t * rgt =
+        (x < MC_CHUNK_SIZE - 1) ? &chunk->occupancy[(x + 1) << MC_CHUNK_SIZE_LOG2] :
+        (right != NULL)         ? &right->occupancy[0] :
+                                  mc_chunk_occupancy_empty;
+
+    // the slice padded with the rows of the chunks above and below
+    uint32_t col[MC_CHUNK_SIZE + 2];
+    col[0] = (bottom != NULL) ? mc_chunk_occupancy_row(bottom, x, MC_CHUNK_SIZE - 1) : 0;
+    col[MC_CHUNK_SIZE + 1] = (top != NULL) ? mc_chunk_occupancy_row(top, x, 0) : 0;
+    memcpy(&col[1], mid, sizeof(*mid) * MC_CHUNK_SIZE);
+
+    // the blocks right behind / in front of each row
+    uint32_t behind[MC_CHUNK_SIZE];
+    uint32_t ahead[MC_CHUNK_SIZE];
+    for (int y = 0; y < MC_CHUNK_SIZE; y++) {
+        behind[y] = (back  != NULL) ? (mc_chunk_occupancy_row(back,  x, y) >> (MC_CHUNK_SIZE - 1)) : 0;
+        ahead[y]  = (front != NULL) ? (mc_chunk_occupancy_row(front, x, y) << (MC_CHUNK_SIZE - 1)) : 0;
+    }
+
+    for (int y = 0; y < MC_CHUNK_SIZE; y++) {
+        uint32_t row = col[y + 1];
+        faces[MC_BLOCK_FACE_LEFT  ][y] = row & ~lft[y];
+        faces[MC_BLOCK_FACE_RIGHT ][y] = row & ~rgt[y];
+        faces[MC_BLOCK_FACE_BOTTOM][y] = row & ~col[y];
+        faces[MC_BLOCK_FACE_TOP   ][y] = row & ~col[y + 2];
+        faces[MC_BLOCK_FACE_BACK  ][y] = row & ~((row << 1) | behind[y]);
+        faces[MC_BLOCK_FACE_FRONT ][y] = row & ~((row >> 1) | ahead[y]);
+    }
+}
+
+/*
+ * The MC_CHUNK_CELL sized cubes of the chunk that are completely filled with opaque blocks, as bit (cx * MC_CHUNK_CELLS + cy) * MC_CHUNK_CELLS + cz.
+ * A cell is filled if the AND of its rows has all of its bits along Z set.
+ */
+uint64_t mc_chunk_solid_cells (const struct mc_Chunk * chunk) {
+    assert(chunk != NULL);
+    _Static_assert(MC_CHUNK_CELLS * MC_CHUNK_CELLS * MC_CHUNK_CELLS <= 64, "a bit per cell");
+    if (chunk->occupancy == mc_chunk_occupancy_empty)
+        return 0;
+    uint64_t cells = 0;
+    for (int cx = 0; cx < MC_CHUNK_CELLS; cx++)
+    for (int cy = 0; cy < MC_CHUNK_CELLS; cy++) {
+        uint32_t rows = ~(uint32_t)0;
+        for (int x = cx * MC_CHUNK_CELL; x < (cx + 1) * MC_CHUNK_CELL; x++)
+        for (int y = cy * MC_CHUNK_CELL; y < (cy + 1) * MC_CHUNK_CELL; y++)
+            rows &= mc_chunk_occupancy_row(chunk, x, y);
+        for (int cz = 0; cz < MC_CHUNK_CELLS; cz++) {
+            uint32_t mask = ((1u << MC_CHUNK_CELL) - 1) << (cz * MC_CHUNK_CELL);
+            if ((rows & mask) == mask)
+                cells |= (uint64_t)1 << ((cx * MC_CHUNK_CELLS + cy) * MC_CHUNK_CELLS + cz);
+        }
+    }
+    return cells;
+}
+
+// the runs of set bits in `open` that contain a bit of `seeds`, grown both ways along Z in log2 steps
+static inline uint32_t fill_runs (uint32_t open, uint32_t seeds) {
+    uint32_t up = seeds & open, down = up, pu = open, pd = open;
+    for (int shift = 1; shift < MC_CHUNK_SIZE; shift *= 2) {
+        up   |= pu & (up   << shift);
+        down |= pd & (down >> shift);
+        pu &= pu << shift;
+        pd &= pd >> shift;
+    }
+    return up | down;
+}
+
+// the faces of the chunk the blocks `added` in row (x, y) lie on
+static inline uint8_t row_faces (int x, int y, uint32_t added) {
+    uint8_t faces = 0;
+    faces |= (x == 0)                 ? 1 << MC_BLOCK_FACE_LEFT   : 0;
+    faces |= (x == MC_CHUNK_SIZE - 1) ? 1 << MC_BLOCK_FACE_RIGHT  : 0;
+    faces |= (y == 0)                 ? 1 << MC_BLOCK_FACE_BOTTOM : 0;
+    faces |= (y == MC_CHUNK_SIZE - 1) ? 1 << MC_BLOCK_FACE_TOP    : 0;
+    faces |= (added & 1)                        ? 1 << MC_BLOCK_FACE_BACK  : 0;
+    faces |= (added >> (MC_CHUNK_SIZE - 1) & 1) ? 1 << MC_BLOCK_FACE_FRONT : 0;
+    return added ? faces : 0;
+}
+
+/*
+ * Which faces of the chunk can be seen from which through the blocks that aren't opaque (empty here): bit g of links[f]
+ * is set if some empty block on face f is connected to one on face g, bit f of links[f] if face f has any empty block.
+ * Every group of connected empty blocks that touches a face is flood filled a row at a time, see mc_world_draw.
+ */
+void mc_chunk_face_links (const struct mc_Chunk * chunk, uint8_t links[MC_BLOCK_FACES]) {
+    assert(chunk != NULL);
+    assert(links != NULL);
+    memset(links, 0, MC_BLOCK_FACES);
+    if (chunk->occupancy == mc_chunk_occupancy_full)
+        return;
+    if (chunk->occupancy == mc_chunk_occupancy_empty) {
+        memset(links, (1 << MC_BLOCK_FACES) - 1, MC_BLOCK_FACES);
+        return;
+    }
+
+    uint32_t visited[MC_OCCUPANCY_ROWS] = {0};
+    uint32_t queued[MC_OCCUPANCY_ROWS / 32] = {0};
+    uint16_t stack[MC_OCCUPANCY_ROWS];
+    for (int row = 0; row < MC_OCCUPANCY_ROWS; row++) {
+        int x = row >> MC_CHUNK_SIZE_LOG2, y = row & (MC_CHUNK_SIZE - 1);
+        uint32_t open = ~chunk->occupancy[row];
+        MC_BOOL side = (x == 0) || (x == MC_CHUNK_SIZE - 1) || (y == 0) || (y == MC_CHUNK_SIZE - 1);
+        uint32_t seeds = open & ~visited[row] & (side ? ~(uint32_t)0 : (1u | 1u << (MC_CHUNK_SIZE - 1)));
+        if (seeds == 0)
+            continue;
+
+        // a new group, from the lowest of its blocks on the faces of the chunk
+        uint32_t added = fill_runs(open, seeds & -seeds);
+        visited[row] |= added;
+        uint8_t faces = row_faces(x, y, added);
+        size_t top = 0;
+        stack[top++] = (uint16_t)row;
+        queued[row / 32] |= 1u << (row % 32);
+        while (top > 0) {
+            int r = stack[--top];
+            queued[r / 32] &= ~(1u << (r % 32));
+            int rx = r >> MC_CHUNK_SIZE_LOG2, ry = r & (MC_CHUNK_SIZE - 1);
+            for (int d = 0; d < 4; d++) {
+                int nx = rx + ((d == 0) ? -1 : (d == 1) ? 1 : 0);
+                int ny = ry + ((d == 2) ? -1 : (d == 3) ? 1 : 0);
+                if ((nx < 0) || (nx >= MC_CHUNK_SIZE) || (ny < 0) || (ny >= MC_CHUNK_SIZE))
+                    continue;
+                int n = (nx << MC_CHUNK_SIZE_LOG2) | ny;
+                uint32_t spread = visited[r] & ~chunk->occupancy[n] & ~visited[n];
+                if (spread == 0)
+                    continue;
+                added = fill_runs(~chunk->occupancy[n], spread) & ~visited[n];
+                visited[n] |= added;
+                faces |= row_faces(nx, ny, added);
+                if (!(queued[n / 32] & (1u << (n % 32)))) {
+                    queued[n / 32] |= 1u << (n % 32);
+                    stack[top++] = (uint16_t)n;
+                }
+            }
+        }
+        for (int f = 0; f < MC_BLOCK_FACES; f++)
+            if (faces & (1 << f))
+                links[f] |= faces;
+    }
+}
+
+/*
+ * The occupancy of the layer of blocks on the face `face` of the chunk, as 32 rows:
+ * along X (LEFT, RIGHT) rows[y] has bit z set, along Y (BOTTOM, TOP) rows[x] has bit z set
+ * and along Z (BACK, FRONT) rows[x] has bit y set.
+ */
+void mc_chunk_border (const struct mc_Chunk * chunk, enum mc_BlockFace face, uint32_t rows[MC_CHUNK_SIZE]) {
+    assert(chunk != NULL);
+    assert(rows != NULL);
+    int side = (face & 1) ? MC_CHUNK_SIZE - 1 : 0;
+    switch (face) {
+    case MC_BLOCK_FACE_LEFT:
+    case MC_BLOCK_FACE_RIGHT:
+        for (int y = 0; y < MC_CHUNK_SIZE; y++)
+            rows[y] = mc_chunk_occupancy_row(chunk, side, y);
+        break;
+    case MC_BLOCK_FACE_BOTTOM:
+    case MC_BLOCK_FACE_TOP:
+        for (int x = 0; x < MC_CHUNK_SIZE; x++)
+            rows[x] = mc_chunk_occupancy_row(chunk, x, side);
+        break;
+    case MC_BLOCK_FACE_BACK:
+    case MC_BLOCK_FACE_FRONT:
+        for (int x = 0; x < MC_CHUNK_SIZE; x++) {
+            uint32_t row = 0;
+            for (int y = 0; y < MC_CHUNK_SIZE; y++)
+                row |= ((mc_chunk_occupancy_row(chunk, x, y) >> side) & 1) << y;
+            rows[x] = row;
+        }
+        break;
+    }
+}
@@ -0,0 +1,114 @@
+/*
+ *
+ * Open addressing (linear probing) hash map of the loaded chunks
+ *
+ */
+
+#include "mc.h"
+
+#include <stdlib.h>
+
+#define MC_CHUNKMAP_INITIAL_CAP (1024)
+#define MC_CHUNKMAP_MAX_LOAD    (0.5)
+
+static inline size_t hash (int cx, int cy, int cz) {
+    uint32_t h = (uint32_t)cx * 73856093u ^ (uint32_t)cy * 19349663u ^ (uint32_t)cz * 83492791u;
+    h ^= h >> 16;
+    h *= 0x85EBCA6Bu;
+    h ^= h >> 13;
+    return h;
+}
+
+static inline size_t chunk_hash (const struct mc_Chunk * chunk) {
+    return hash(chunk->pos[0], chunk->pos[1], chunk->pos[2]);
+}
+
+static void alloc_entries (struct mc_ChunkMap * map, size_t cap) {
+    assert(map != NULL);
+    assert((cap & (cap - 1)) == 0);
+    map->cap = cap;
+    map->count = 0;
+    map->entries = calloc(cap, sizeof(*map->entries));
+    assert(map->entries != NULL);
+}
+
+static void grow (struct mc_ChunkMap * map) {
+    assert(map != NULL);
+    struct mc_Chunk ** old = map->entries;
+    size_t old_cap = map->cap;
+    alloc_entries(map, old_cap * 2);
+    for (size_t i = 0; i < old_cap; i++)
+        if (old[i] != NULL)
+            mc_chunkmap_insert(map, old[i]);
+    free(old);
+}
+
+/*============================================================================================================
+ *
+ *
+ *
+ *==========================================================================================================*/
+
+void mc_chunkmap_init (struct mc_ChunkMap * map) {
+    assert(map != NULL);
+    alloc_entries(map, MC_CHUNKMAP_INITIAL_CAP);
+}
+
+// doesn't destroy the chunks
+void mc_chunkmap_free (struct mc_ChunkMap * map) {
+    assert(map != NULL);
+    free(map->entries);
+    map->entries = NULL;
+    map->cap = 0;
+    map->count = 0;
+}
+
+struct mc_Chunk * mc_chunkmap_get (struct mc_ChunkMap * map, int cx, int cy, int cz) {
+    assert(map != NULL);
+    size_t mask = map->cap - 1;
+    for (size_t i = hash(cx, cy, cz) & mask;; i = (i + 1) & mask) {
+        struct mc_Chunk * chunk = map->entries[i];
+        if (chunk == NULL)
+            return NULL;
+        if ((chunk->pos[0] == cx) && (chunk->pos[1] == cy) && (chunk->pos[2] == cz))
+            return chunk;
+    }
+}
+
+void mc_chunkmap_insert (struct mc_ChunkMap * map, struct mc_Chunk * chunk) {
+    assert(map != NULL);
+    assert(chunk != NULL);
+    assert(mc_chunkmap_get(map, chunk->pos[0], chunk->pos[1], chunk->pos[2]) == NULL);
+    if (map->count + 1 > map->cap * MC_CHUNKMAP_MAX_LOAD)
+        grow(map);
+    size_t mask = map->cap - 1;
+    size_t i = chunk_hash(chunk) & mask;
+    while (map->entries[i] != NULL)
+        i = (i + 1) & mask;
+    map->entries[i] = chunk;
+    map->count++;
+}
+
+// backward shift deletion, no tombstones
+void mc_chunkmap_remove (struct mc_ChunkMap * map, struct mc_Chunk * chunk) {
+    assert(map != NULL);
+    assert(chunk != NULL);
+    size_t mask = map->cap - 1;
+    size_t hole = chunk_hash(chunk) & mask;
+    while (map->entries[hole] != chunk) {
+        assert(map->entries[hole] != NULL);
+        hole = (hole + 1) & mask;
+    }
+    for (size_t i = (hole + 1) & mask;; i = (i + 1) & mask) {
+        struct mc_Chunk * next = map->entries[i];
+        if (next == NULL)
+            break;
+        size_t home = chunk_hash(next) & mask;
+        if (((i - home) & mask) >= ((i - hole) & mask)) {
+            map->entries[hole] = next;
+            hole = i;
+        }
+    }
+    map->entries[hole] = NULL;
+    map->count--;
+}
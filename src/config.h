@@ -17,6 +17,14 @@
 #define MC_FOV                  (90.0f)
 #define MC_RENDER_DISTANCE      (512) // in blocks
 #define MC_WORLD_HEIGHT         (64)
+#define MC_CHUNK_SIZE_LOG2      (5)
+#define MC_CHUNK_SIZE           (1 << MC_CHUNK_SIZE_LOG2) // in blocks
+#define MC_CHUNK_MORTON         (0) // 1 - Z-order block indices inside a chunk, 0 - linear (x-major), see maincraft_bench
+#define MC_STREAM_THREADS       (3)
+#define MC_STREAM_PREFETCH      (1.0f) // in seconds, how far ahead of the camera the chunks are loaded
+#define MC_STREAM_CHUNKS_PER_FRAME (4) // finished chunks the main thread uploads per frame
+#define MC_UPLOAD_RING_SIZE     (16 * 1024 * 1024) // in bytes, shared by everything streamed to the GPU every frame
+#define MC_WORLD_UPLOAD_BUDGET  (MC_UPLOAD_RING_SIZE / 4) // in bytes per frame, the remaining changed chunks wait for the next one
 #define MC_INDICATOR_BLOCK_ALPHA (0.6f)
 
 //
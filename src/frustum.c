@@ -0,0 +1,66 @@
+/*
+ *
+ * Frustum
+ * The six clip planes of a proj * view matrix, boxes are tested against them MC_FRUSTUM_LANES at a time.
+ * A box is culled only if it lies entirely outside one of the planes, so boxes near the corners
+ * of the frustum may be kept even though they can't be seen.
+ *
+ */
+
+#include "mc.h"
+
+#include <math.h>
+
+typedef float mc_Lanes __attribute__((vector_size(MC_FRUSTUM_LANES * sizeof(float))));
+typedef int32_t mc_LaneMask __attribute__((vector_size(MC_FRUSTUM_LANES * sizeof(int32_t))));
+
+/*============================================================================================================
+ *
+ *
+ *
+ *==========================================================================================================*/
+
+// the planes of the clip space volume -w <= x, y, z <= w, pointing inwards (Gribb and Hartmann)
+void mc_frustum_from_matrix (struct mc_Frustum * frustum, mat4 m) {
+    assert(frustum != NULL);
+    assert(m != NULL);
+    for (int p = 0; p < 6; p++) {
+        int row = p / 2;
+        float sign = (p & 1) ? -1.0f : 1.0f;
+        for (int c = 0; c < 4; c++)
+            frustum->planes[p][c] = m[c][3] + sign * m[c][row];
+    }
+}
+
+/*
+ * Sets visible[i] to 1 if the box i may be inside the frustum and to 0 if it's not, returns how many are.
+ * The boxes are given by their centres (box[0], box[1], box[2]) and half sizes (box[3], box[4], box[5]),
+ * every array has to hold `count` rounded up to a multiple of MC_FRUSTUM_LANES, so does `visible`.
+ */
+size_t mc_frustum_cull (const struct mc_Frustum * frustum, const float * const box[6], size_t count, uint8_t * visible) {
+    assert(frustum != NULL);
+    assert(box != NULL);
+    assert(visible != NULL);
+    size_t n = 0;
+    for (size_t i = 0; i < count; i += MC_FRUSTUM_LANES) {
+        mc_Lanes cx, cy, cz, ex, ey, ez;
+        memcpy(&cx, &box[0][i], sizeof(cx));
+        memcpy(&cy, &box[1][i], sizeof(cy));
+        memcpy(&cz, &box[2][i], sizeof(cz));
+        memcpy(&ex, &box[3][i], sizeof(ex));
+        memcpy(&ey, &box[4][i], sizeof(ey));
+        memcpy(&ez, &box[5][i], sizeof(ez));
+        mc_LaneMask outside = {0};
+        for (int p = 0; p < 6; p++) {
+            const float * pl = frustum->planes[p];
+            mc_Lanes dist   = pl[0] * cx + pl[1] * cy + pl[2] * cz + pl[3];
+            mc_Lanes radius = fabsf(pl[0]) * ex + fabsf(pl[1]) * ey + fabsf(pl[2]) * ez;
+            outside |= (dist < -radius);
+        }
+        for (int l = 0; l < MC_FRUSTUM_LANES; l++) {
+            visible[i + l] = (outside[l] == 0);
+            n += (i + l < count) && visible[i + l];
+        }
+    }
+    return n;
+}
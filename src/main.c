@@ -22,6 +22,7 @@ static void cursor_pos_callback (GLFWwindow *window, double xpos, double ypos);
 static struct {
     struct mc_Camera camera;
     struct mc_World world;
+    struct mc_UploadRing upload;
     GLFWwindow *window;
 
     struct {
@@ -44,10 +45,17 @@ static struct {
         char look[MC_TEXT_MAX_CHARS];
         char block[MC_TEXT_MAX_CHARS];
         char offset[MC_TEXT_MAX_CHARS];
+        char chunks[MC_TEXT_MAX_CHARS];
         char vertices[MC_TEXT_MAX_CHARS];
         char mem_vertices[MC_TEXT_MAX_CHARS];
         char mem_blocks[MC_TEXT_MAX_CHARS];
+        char mem_mesh[MC_TEXT_MAX_CHARS];
         char mem_total[MC_TEXT_MAX_CHARS];
+        char upload[MC_TEXT_MAX_CHARS];
+        char chunk_uploads[MC_TEXT_MAX_CHARS];
+        char drawn[MC_TEXT_MAX_CHARS];
+        char culling[MC_TEXT_MAX_CHARS];
+        char overdraw[MC_TEXT_MAX_CHARS];
     } txt;
 
     struct mc_TextRenderer textr;
@@ -62,35 +70,35 @@ static struct {
  * 
  */
 
-static struct mc_Block* hit_block_in_reach (void) {
-	// Standard unoptimized ray marching
+static mc_BlockID hit_block_in_reach (void) {
+	// Ray marching against the occupancy bits, only the block the ray is in is tested at every step
 	glm_vec3_copy(G.camera.pos, G.rayhitpos);
+	int cx = mc_block_coord(G.camera.pos[0]);
+	int cy = mc_block_coord(G.camera.pos[1]);
+	int cz = mc_block_coord(G.camera.pos[2]);
 	for (size_t r = 0; r < MC_REACH / MC_RAY_PRECISION; r++) {
-        for (int x = mc_block_coord(G.camera.pos[0]) - MC_REACH; x < mc_block_coord(G.camera.pos[0]) + MC_REACH; x++)
-        for (int y = mc_block_coord(G.camera.pos[1]) - MC_REACH; y < mc_block_coord(G.camera.pos[1]) + MC_REACH; y++)
-        for (int z = mc_block_coord(G.camera.pos[2]) - MC_REACH; z < mc_block_coord(G.camera.pos[2]) + MC_REACH; z++) {
-            struct mc_Block *block = mc_world_block_at(&G.world, x, y, z);
-            if (block == NULL)
-                continue;
-            if (!block->exists)
-                continue;
-
-            if (mc_block_coord(G.rayhitpos[0]) == x)
-            if (mc_block_coord(G.rayhitpos[1]) == y)
-            if (mc_block_coord(G.rayhitpos[2]) == z) {
-                // revert last step
-                G.rayprehitpos[0] = G.rayhitpos[0] - G.camera.front[0] * MC_BLOCK_SIZE * MC_RAY_PRECISION;
-                G.rayprehitpos[1] = G.rayhitpos[1] - G.camera.front[1] * MC_BLOCK_SIZE * MC_RAY_PRECISION;
-                G.rayprehitpos[2] = G.rayhitpos[2] - G.camera.front[2] * MC_BLOCK_SIZE * MC_RAY_PRECISION;
-                return block;
-            }
+        int x = mc_block_coord(G.rayhitpos[0]);
+        int y = mc_block_coord(G.rayhitpos[1]);
+        int z = mc_block_coord(G.rayhitpos[2]);
+        MC_BOOL in_reach = (x >= cx - MC_REACH) && (x < cx + MC_REACH)
+                        && (y >= cy - MC_REACH) && (y < cy + MC_REACH)
+                        && (z >= cz - MC_REACH) && (z < cz + MC_REACH);
+        // the translucent blocks aren't in the occupancy, they're looked up if there are any
+        MC_BOOL hit = in_reach && (mc_world_is_occupied(&G.world, x, y, z)
+                   || ((MC_BLOCK_TRANSLUCENT_TYPES != 0) && MC_BLOCK_EXISTS(mc_world_block_at(&G.world, x, y, z))));
+        if (hit) {
+            // revert last step
+            G.rayprehitpos[0] = G.rayhitpos[0] - G.camera.front[0] * MC_BLOCK_SIZE * MC_RAY_PRECISION;
+            G.rayprehitpos[1] = G.rayhitpos[1] - G.camera.front[1] * MC_BLOCK_SIZE * MC_RAY_PRECISION;
+            G.rayprehitpos[2] = G.rayhitpos[2] - G.camera.front[2] * MC_BLOCK_SIZE * MC_RAY_PRECISION;
+            return mc_world_block_at(&G.world, x, y, z);
         }
         // step
         G.rayhitpos[0] += G.camera.front[0] * MC_BLOCK_SIZE * MC_RAY_PRECISION;
         G.rayhitpos[1] += G.camera.front[1] * MC_BLOCK_SIZE * MC_RAY_PRECISION;
         G.rayhitpos[2] += G.camera.front[2] * MC_BLOCK_SIZE * MC_RAY_PRECISION;
 	}
-	return NULL;
+	return MC_BLOCK_TYPE_NONE;
 }
 
 /*
@@ -139,9 +147,8 @@ int main (void) {
 
     stbi_set_flip_vertically_on_load(1);
 
-    // glEnable(GL_CULL_FACE);
+    glEnable(GL_CULL_FACE); // every quad is wound counter-clockwise seen from the front
 	glEnable(GL_DEPTH_TEST);
-	glEnable(GL_BLEND);
 	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
     //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -187,6 +194,8 @@ int main (void) {
     /*
      *
      * Block Texture Atlas
+     * The atlas is a vertical strip of textures, uploaded as an array texture (one texture per layer)
+     * so that merged faces can repeat their texture
      * 
      */
     GLuint block_texatlas;
@@ -194,12 +203,12 @@ int main (void) {
         struct mc_Texture texatlas;
         mc_tex_load(&texatlas, "texatlas.jpg");
         glGenTextures(1, &block_texatlas);
-        glBindTexture(GL_TEXTURE_2D, block_texatlas);
-        glTexImage2D(GL_TEXTURE_2D, 0, texatlas.intfrmt, MC_BLOCKTEX_BLOCKSIZE, MC_BLOCKTEX_BLOCKS * MC_BLOCKTEX_BLOCKSIZE, 0, texatlas.datafrmt, GL_UNSIGNED_BYTE, texatlas.data);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, block_texatlas);
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, texatlas.intfrmt, MC_BLOCKTEX_BLOCKSIZE, MC_BLOCKTEX_BLOCKSIZE, MC_BLOCKTEX_BLOCKS, 0, texatlas.datafrmt, GL_UNSIGNED_BYTE, texatlas.data);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
         mc_tex_unload(&texatlas);
     }
 
@@ -220,53 +229,34 @@ int main (void) {
         glUseProgram(prog);
         glUniformMatrix4fv(glGetUniformLocation(prog, "proj"), 1, GL_FALSE, proj);
         mc_program_set_int(prog, "tex", 0);
+        mc_program_set_float(prog, "blockSize", MC_BLOCK_SIZE);
+        mc_program_set_float(prog, "translucentAlpha", MC_INDICATOR_BLOCK_ALPHA);
+        mc_program_set_int(prog, "faces", MC_WORLD_FACES_TEXTURE_UNIT);
         uView = glGetUniformLocation(prog, "view");
     }
 
     mc_tex_create(&G.texfont, "res/img/font.png");
 	MC_BOOL can_place_block = MC_TRUE;
 	MC_BOOL can_destroy_block = MC_TRUE;
-	MC_BOOL player_moved = MC_FALSE;
+	MC_BOOL player_moved = MC_TRUE; // sets the view matrix on the first frame
 	mc_camera_init(&G.camera);
-    mc_textr_create(&G.textr);
-	mc_world_init(&G.world, 0);
+    mc_upload_init(&G.upload, MC_UPLOAD_RING_SIZE);
+    mc_textr_create(&G.textr, &G.upload);
+	mc_world_init(&G.world, 0, &G.upload);
     G.mouse.moved = MC_TRUE;
 
-    MC_BOOL reset_indicator_block = MC_FALSE;
-
-    // glEnable(GL_CULL_FACE);
-    // glCullFace(GL_FRONT);
-    // glFrontFace(GL_CW);
-
 	//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-    // struct mc_Block indicator_block = {
-    //     .type = MC_BLOCK_TYPE_GRASS,
-    //     .vertofs_back  = MC_BLOCK_FACE_VERTICES * 0,
-    //     .vertofs_front = MC_BLOCK_FACE_VERTICES * 1,
-    //     .vertofs_top   = MC_BLOCK_FACE_VERTICES * 2,
-    //     .vertofs_bot   = MC_BLOCK_FACE_VERTICES * 3,
-    //     .vertofs_left  = MC_BLOCK_FACE_VERTICES * 4,
-    //     .vertofs_right = MC_BLOCK_FACE_VERTICES * 5
-    // };
-    // G.world.blockvc += MC_BLOCK_VERTICES;
-
     /*
      *
      * Terrain Generation
      * 
      */
     {
-        fnl_state fnl = fnlCreateState();
-        fnl.noise_type = FNL_NOISE_PERLIN;
-
-        for (int x = 0; x < MC_RENDER_DISTANCE; x++)
-        for (int z = 0; z < MC_RENDER_DISTANCE; z++)
-        for (int y = 0; y < MC_WORLD_HEIGHT;    y++) {
-            float noise = fnlGetNoise3D(&fnl, x, y, z);
-            if (noise > 0.0f)
-                mc_world_place_block_at(&G.world, x, y, z, MC_BLOCK_TYPE_GRASS);
-        }
+        // the chunks are streamed in from here on, see mc_world_update
+        vec3 eye;
+        glm_vec3_divs(G.camera.pos, MC_BLOCK_SIZE, eye);
+        mc_world_follow(&G.world, eye, G.camera.front, GLM_VEC3_ZERO);
 
         // mc_world_place_block_at(&G.world, 0, 0, 0, MC_BLOCK_TYPE_GRASS);
         // mc_world_place_block_at(&G.world, 1, 0, 0, MC_BLOCK_TYPE_GRASS);
@@ -290,13 +280,18 @@ int main (void) {
     puts("done!");
     glClearColor(0.67f, 0.84f, 1.0f, 1.0f);
     double last_time = glfwGetTime();
+    double last_frame_time = last_time;
+    vec3 last_eye;
+    glm_vec3_divs(G.camera.pos, MC_BLOCK_SIZE, last_eye);
     size_t fps = 0;
+    double frame_ms = 0.0;
 
 	while (!glfwWindowShouldClose(G.window)) {
         fps++;
         double cur_time = glfwGetTime();
         if (cur_time - last_time >= 1.0) {
             printf("fps: %d\n", fps);
+            frame_ms = (cur_time - last_time) * 1000.0 / fps;
             fps = 0;
             last_time = cur_time;
         }
@@ -324,9 +319,6 @@ int main (void) {
                 glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
             else
                 glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-
-            if (glfwGetKey(G.window, GLFW_KEY_L) == GLFW_PRESS)
-                mc_world_move(&G.world, 1, 0, 0);
         }
 
         /*
@@ -343,6 +335,15 @@ int main (void) {
                 if (G.mouse.moved) G.mouse.moved = MC_FALSE;
             }
 
+            vec3 eye, velocity;
+            glm_vec3_divs(G.camera.pos, MC_BLOCK_SIZE, eye);
+            glm_vec3_sub(eye, last_eye, velocity);
+            glm_vec3_scale(velocity, 1.0f / MC_MAX(cur_time - last_frame_time, 1e-3), velocity);
+            glm_vec3_copy(eye, last_eye);
+            last_frame_time = cur_time;
+            mc_world_follow(&G.world, eye, G.camera.front, velocity);
+            mc_world_update(&G.world, MC_STREAM_CHUNKS_PER_FRAME);
+
             if (!can_place_block)
             if (glfwGetMouseButton(G.window, GLFW_MOUSE_BUTTON_RIGHT) == GLFW_RELEASE)
                 can_place_block = MC_TRUE;
@@ -356,17 +357,16 @@ int main (void) {
          * Block
          * 
          */
-        struct mc_Block *block_hit = hit_block_in_reach();
+        mc_BlockID block_hit = hit_block_in_reach();
         {
-            if (block_hit != NULL) {
-                // mc_world_send_faces(&G.world, &indicator_block,
-                //     mc_block_coord(G.rayprehitpos[0]),
-                //     mc_block_coord(G.rayprehitpos[1]),
-                //     mc_block_coord(G.rayprehitpos[2]),
-                //     MC_INDICATOR_BLOCK_ALPHA,
-                //     MC_BLOCK_FACE_ALL
-                // );
-                reset_indicator_block = MC_TRUE;
+            if (MC_BLOCK_EXISTS(block_hit)) {
+                // where the block would be placed
+                mc_world_set_indicator(&G.world,
+                    mc_block_coord(G.rayprehitpos[0]),
+                    mc_block_coord(G.rayprehitpos[1]),
+                    mc_block_coord(G.rayprehitpos[2]),
+                    MC_BLOCK_TYPE_GRASS
+                );
 
                 if (can_place_block)
                 if (glfwGetMouseButton(G.window, GLFW_MOUSE_BUTTON_RIGHT) == GLFW_PRESS) {
@@ -384,19 +384,17 @@ int main (void) {
                     int x = mc_block_coord(G.rayhitpos[0]);
                     int y = mc_block_coord(G.rayhitpos[1]);
                     int z = mc_block_coord(G.rayhitpos[2]);
-                    // struct mc_Block * block = mc_world_block_at(&G.world, x, y, z);
-                    // if (block != NULL)
-                    //     mc_save_block(&G.world, x, y, z, block->type);
+                    // mc_BlockID block = mc_world_block_at(&G.world, x, y, z);
+                    // if (MC_BLOCK_EXISTS(block))
+                    //     mc_save_block(&G.world, x, y, z, block);
                     mc_world_destroy_block_at(&G.world, x, y, z);
                     // mc_world_update(&G.world);
                     can_destroy_block = MC_FALSE;
                 } 
 
             }
-            else if (reset_indicator_block) {
-                // mc_world_send_faces(&G.world, &indicator_block, 0, 0, 0, 0.0f, MC_BLOCK_FACE_ALL);
-                reset_indicator_block = MC_FALSE;
-            }
+            else
+                mc_world_set_indicator(&G.world, 0, 0, 0, MC_BLOCK_TYPE_NONE);
         }
 
         /*
@@ -405,22 +403,35 @@ int main (void) {
          * 
          */
         {
-            if (block_hit == NULL)
+            if (!MC_BLOCK_EXISTS(block_hit))
                 snprintf(G.txt.block, MC_TEXT_MAX_CHARS, "block hit           : NONE");
             else
                 snprintf(G.txt.block, MC_TEXT_MAX_CHARS, "block hit           : %d, %d, %d", mc_block_coord(G.rayhitpos[0]), mc_block_coord(G.rayhitpos[1]), mc_block_coord(G.rayhitpos[2]));
 
-            unsigned long long mem_vertices      = G.world.face_indices_top * sizeof(float) / 1024 / 1024;
-            unsigned long long mem_blocks        = MC_WORLD_MAX_BLOCKS * sizeof(struct mc_Block) / 1024 / 1024;
-            unsigned long long mem_total         = mem_vertices + mem_blocks;
+            unsigned long long mem_vertices      = mc_world_vertices_memory(&G.world) / 1024 / 1024;
+            double             vertices_used     = mc_world_vertices_used(&G.world) / (double)mc_world_vertices_memory(&G.world) * 100;
+            unsigned long long mem_blocks        = mc_world_blocks_memory(&G.world) / 1024 / 1024;
+            unsigned long long mem_mesh          = mc_world_mesh_memory(&G.world) / 1024 / 1024;
+            unsigned long long mem_total         = mem_vertices + mem_blocks + mem_mesh;
 
             snprintf(G.txt.pos,               MC_TEXT_MAX_CHARS, "pos                 : %d, %d, %d",           mc_block_coord(G.camera.pos[0]), mc_block_coord(G.camera.pos[1]), mc_block_coord(G.camera.pos[2]));
             snprintf(G.txt.look,              MC_TEXT_MAX_CHARS, "look                : %d, %d, %d",           G.camera.front[0] < 0 ? -1 : 1, G.camera.front[1] < 0 ? -1 : 1, G.camera.front[2] < 0 ? -1 : 1);
             snprintf(G.txt.offset,            MC_TEXT_MAX_CHARS, "offset              : %d, %d, %d",           G.world.offset[0], G.world.offset[1], G.world.offset[2]);
-            snprintf(G.txt.vertices,          MC_TEXT_MAX_CHARS, "vertices            : %llu / %llu (%.1f%%)", G.world.face_indices_top / 7, MC_WORLD_MAX_VERTICES / 7, G.world.face_indices_top / (double)MC_WORLD_MAX_VERTICES * 100);
-            snprintf(G.txt.mem_vertices,      MC_TEXT_MAX_CHARS, "mem - vertices      : %llu MB (%.1f%%)",     mem_vertices, mem_vertices / (double)mem_total * 100);
+            snprintf(G.txt.chunks,            MC_TEXT_MAX_CHARS, "chunks              : %zu (+%zu streaming)",  G.world.chunks.count, mc_stream_pending(&G.world.stream));
+            snprintf(G.txt.vertices,          MC_TEXT_MAX_CHARS, "faces               : %zu (%s, %s, %.2f ms, G/V to switch)", G.world.faces_count, G.world.greedy ? "greedy" : "per face", G.world.pulling ? "pulled" : "vertices", frame_ms);
+            snprintf(G.txt.mem_vertices,      MC_TEXT_MAX_CHARS, "mem - vertices      : %llu MB (%.1f%%), %.1f%% used, %zu resizes", mem_vertices, mem_vertices / (double)mem_total * 100, vertices_used, G.world.vbo_resizes);
             snprintf(G.txt.mem_blocks,        MC_TEXT_MAX_CHARS, "mem - blocks        : %llu MB (%.1f%%)",     mem_blocks,   mem_blocks   / (double)mem_total * 100);
+            snprintf(G.txt.mem_mesh,          MC_TEXT_MAX_CHARS, "mem - mesh          : %llu MB (%.1f%%)",     mem_mesh,     mem_mesh     / (double)mem_total * 100);
             snprintf(G.txt.mem_total,         MC_TEXT_MAX_CHARS, "mem - total         : %llu MB",              mem_total);
+            const struct mc_WorldUploadStats * us = &G.world.upload_stats;
+            snprintf(G.txt.chunk_uploads,     MC_TEXT_MAX_CHARS, "chunk uploads       : %zu copies (%zu saved), %zu MB (%zu MB saved)", us->copies, us->runs - us->copies, us->bytes / 1024 / 1024, (us->meshed_bytes - MC_MIN(us->meshed_bytes, us->bytes)) / 1024 / 1024);
+            snprintf(G.txt.upload,            MC_TEXT_MAX_CHARS, "upload              : %zu KB in %zu maps (%zu stalls)", G.upload.last_frame_bytes / 1024, G.upload.last_frame_uploads, G.upload.stalls);
+            const struct mc_WorldCullStats * cs = &G.world.cull_stats;
+            snprintf(G.txt.drawn,             MC_TEXT_MAX_CHARS, "drawn               : %zu of %zu chunks, %zu faces (%zu facing away), %zu translucent", cs->drawn, cs->chunks, cs->drawn_faces, cs->facing_away, cs->translucent);
+            snprintf(G.txt.culling,           MC_TEXT_MAX_CHARS, "culled              : %zu cave, %zu frustum, %zu occluded (%zu occluders)", cs->cave_culled, cs->frustum_culled, cs->occlusion_culled, cs->occluders);
+            int fb_width, fb_height;
+            glfwGetFramebufferSize(G.window, &fb_width, &fb_height);
+            snprintf(G.txt.overdraw,          MC_TEXT_MAX_CHARS, "overdraw            : %.2f samples per pixel (%s, O to switch)", cs->samples / (double)MC_MAX(1, fb_width * fb_height), G.world.front_to_back ? "front to back" : "unsorted");
         }
 
         /*
@@ -432,10 +443,15 @@ int main (void) {
             // World
             glUseProgram(prog);
             glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_2D, block_texatlas);
-            // mc_world_draw(&G.world, 1, (G.world.face_indices_top - MC_BLOCK_FACES) / MC_BLOCK_FACES);
-            // mc_world_draw(&G.world, 0, 1);
-            mc_world_draw(&G.world, 0, G.world.face_indices_top / MC_BLOCK_FACES);
+            glBindTexture(GL_TEXTURE_2D_ARRAY, block_texatlas);
+            mat4 viewproj;
+            vec3 eye;
+            glm_mat4_mul(proj, view, viewproj);
+            glm_vec3_divs(G.camera.pos, MC_BLOCK_SIZE, eye);
+            mc_world_draw(&G.world, prog, viewproj, eye);
+
+            // the world draws with blending only where it has to, the overlays need it everywhere
+            glEnable(GL_BLEND);
 
             // Crosshair
             glUseProgram(G.ch.prog);
@@ -448,10 +464,21 @@ int main (void) {
             mc_textr_draw(&G.textr, 0.0f, 1.0f - MC_TEXT_CHAR_HEIGHT * 1, G.txt.look);
             mc_textr_draw(&G.textr, 0.0f, 1.0f - MC_TEXT_CHAR_HEIGHT * 2, G.txt.block);
             mc_textr_draw(&G.textr, 0.0f, 1.0f - MC_TEXT_CHAR_HEIGHT * 3, G.txt.offset);
-            mc_textr_draw(&G.textr, 0.0f, 1.0f - MC_TEXT_CHAR_HEIGHT * 4, G.txt.vertices);
-            mc_textr_draw(&G.textr, 0.0f, 1.0f - MC_TEXT_CHAR_HEIGHT * 5, G.txt.mem_vertices);
-            mc_textr_draw(&G.textr, 0.0f, 1.0f - MC_TEXT_CHAR_HEIGHT * 6, G.txt.mem_blocks);
-            mc_textr_draw(&G.textr, 0.0f, 1.0f - MC_TEXT_CHAR_HEIGHT * 7, G.txt.mem_total);
+            mc_textr_draw(&G.textr, 0.0f, 1.0f - MC_TEXT_CHAR_HEIGHT * 4, G.txt.chunks);
+            mc_textr_draw(&G.textr, 0.0f, 1.0f - MC_TEXT_CHAR_HEIGHT * 5, G.txt.vertices);
+            mc_textr_draw(&G.textr, 0.0f, 1.0f - MC_TEXT_CHAR_HEIGHT * 6, G.txt.mem_vertices);
+            mc_textr_draw(&G.textr, 0.0f, 1.0f - MC_TEXT_CHAR_HEIGHT * 7, G.txt.mem_blocks);
+            mc_textr_draw(&G.textr, 0.0f, 1.0f - MC_TEXT_CHAR_HEIGHT * 8, G.txt.mem_mesh);
+            mc_textr_draw(&G.textr, 0.0f, 1.0f - MC_TEXT_CHAR_HEIGHT * 9, G.txt.mem_total);
+            mc_textr_draw(&G.textr, 0.0f, 1.0f - MC_TEXT_CHAR_HEIGHT * 10, G.txt.upload);
+            mc_textr_draw(&G.textr, 0.0f, 1.0f - MC_TEXT_CHAR_HEIGHT * 11, G.txt.chunk_uploads);
+            mc_textr_draw(&G.textr, 0.0f, 1.0f - MC_TEXT_CHAR_HEIGHT * 12, G.txt.drawn);
+            mc_textr_draw(&G.textr, 0.0f, 1.0f - MC_TEXT_CHAR_HEIGHT * 13, G.txt.culling);
+            mc_textr_draw(&G.textr, 0.0f, 1.0f - MC_TEXT_CHAR_HEIGHT * 14, G.txt.overdraw);
+            glDisable(GL_BLEND);
+
+            // everything streamed this frame has been used by the commands above
+            mc_upload_frame(&G.upload);
         }
 
 		glfwSwapBuffers(G.window);
@@ -459,6 +486,8 @@ int main (void) {
 	}
 
     mc_world_free(&G.world);
+    mc_textr_destroy(&G.textr);
+    mc_upload_free(&G.upload);
 	mc_program_delete(prog);
 
 saferet:
@@ -475,6 +504,18 @@ static void key_callback (GLFWwindow *window, int key, int scancode, int action,
 	if (action == GLFW_PRESS)
 	if (key == GLFW_KEY_ESCAPE)
 		glfwSetWindowShouldClose(window, 1);
+
+	if (action == GLFW_PRESS)
+	if (key == GLFW_KEY_G)
+		mc_world_set_greedy(&G.world, !G.world.greedy);
+
+	if (action == GLFW_PRESS)
+	if (key == GLFW_KEY_V)
+		mc_world_set_pulling(&G.world, !G.world.pulling);
+
+	if (action == GLFW_PRESS)
+	if (key == GLFW_KEY_O)
+		G.world.front_to_back = !G.world.front_to_back;
 }
 
 static void cursor_pos_callback (GLFWwindow *window, double xpos, double ypos) {
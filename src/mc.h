@@ -12,6 +12,7 @@
 #include <stddef.h>
 #include <string.h>
 #include <assert.h>
+#include <pthread.h>
 
 #include "config.h"
 
@@ -54,6 +55,7 @@ enum mc_Status mc_file_read (const char* fn, char** buffPtr);
 GLuint mc_program_create (const char *name, const char *vertPath, const char *fragPath);
 void mc_program_delete (GLuint ID);
 void mc_program_set_int  (GLuint ID, const char *name, GLint x);
+void mc_program_set_float (GLuint ID, const char *name, GLfloat x);
 
 /*
  *
@@ -71,6 +73,21 @@ void mc_camera_init 	  (struct mc_Camera *cam);
 void mc_camera_mousemov   (struct mc_Camera *cam, float ofsx, float ofsy);
 void mc_camera_viewmatrix (struct mc_Camera *cam, mat4 dest);
 
+/*
+ *
+ * Frustum
+ * 
+ */
+
+#define MC_FRUSTUM_LANES (8) // boxes tested at once, two SSE or one AVX register
+
+struct mc_Frustum {
+    float planes[6][4]; // left, right, bottom, top, near, far: inside where ax + by + cz + d >= 0
+};
+
+void   mc_frustum_from_matrix (struct mc_Frustum * frustum, mat4 m);
+size_t mc_frustum_cull        (const struct mc_Frustum * frustum, const float * const box[6], size_t count, uint8_t * visible);
+
 /*
  *
  * Block
@@ -79,35 +96,478 @@ void mc_camera_viewmatrix (struct mc_Camera *cam, mat4 dest);
  */
 
 #define MC_BLOCK_FACES           (6)
-#define MC_BLOCK_FACE_VERTICES   (6)
+#define MC_BLOCK_FACE_VERTICES   (4)
+#define MC_BLOCK_FACE_INDICES    (6) // two triangles, 0 1 2 and 2 3 0
 #define MC_BLOCK_VERTICES        (MC_BLOCK_FACES * MC_BLOCK_FACE_VERTICES)
-#define MC_BLOCK_VERTEX_ELEMENTS (sizeof(struct mc_BlockVertex) / sizeof(float))
 
+/*
+ * Packed world vertex, decoded by res/shaders/vertex.glsl:
+ * bits  0..17 - x, y, z relative to the chunk origin (6 bits each, 0 .. MC_CHUNK_SIZE)
+ * bits 18..20 - face (enum mc_BlockFace), the texture coordinates are derived from it and the position
+ * bits 21..28 - layer in the block texture array
+ * bits 29..31 - flags (MC_BLOCK_VERTEX_*)
+ */
 struct mc_BlockVertex {
-	float x, y, z;
-    float tx, ty; // texture coords
-	float a; // alpha
+    uint32_t data;
 };
 
+#define MC_BLOCK_VERTEX_TRANSLUCENT (1u << 0) // drawn with MC_INDICATOR_BLOCK_ALPHA instead of opaque
+
+#define MC_BLOCK_VERTEX_PACK(x,y,z,face,layer,flags) \
+    ( (uint32_t)(x) | ((uint32_t)(y) << 6) | ((uint32_t)(z) << 12) | ((uint32_t)(face) << 18) | ((uint32_t)(layer) << 21) | ((uint32_t)(flags) << 29) )
+
+/*
+ * A whole face in 8 bytes, what the mesher produces:
+ * `data` is packed like mc_BlockVertex with the position of the lowest corner,
+ * `size` holds the size of the box the face belongs to in blocks (6 bits per axis, 1 .. MC_CHUNK_SIZE).
+ * With vertex pulling the records are uploaded as they are and the vertex shader expands them.
+ */
+struct mc_FaceRecord {
+    uint32_t data;
+    uint32_t size;
+};
+
+#define MC_FACE_RECORD_POS_MASK (0x3FFFF)
+#define MC_FACE_RECORD_SIZE(x,y,z) ( (uint32_t)(x) | ((uint32_t)(y) << 6) | ((uint32_t)(z) << 12) )
+
+typedef uint16_t mc_BlockID;
+
 enum mc_BlockType {
     MC_BLOCK_TYPE_NONE,
     MC_BLOCK_TYPE_AIR,
     MC_BLOCK_TYPE_GRASS
 };
 
-struct mc_Block {
-    MC_BOOL exists;
-    size_t face_idx_left;
-    size_t face_idx_right;
-    size_t face_idx_top;
-    size_t face_idx_bottom;
-    size_t face_idx_front;
-    size_t face_idx_back;
-    enum mc_BlockType type;
+enum mc_BlockFace {
+    MC_BLOCK_FACE_LEFT,   // -X
+    MC_BLOCK_FACE_RIGHT,  // +X
+    MC_BLOCK_FACE_BOTTOM, // -Y
+    MC_BLOCK_FACE_TOP,    // +Y
+    MC_BLOCK_FACE_BACK,   // -Z
+    MC_BLOCK_FACE_FRONT   // +Z
 };
+#define MC_BLOCK_FACE_OPPOSITE(f) ((f) ^ 1)
+
+#define MC_BLOCK_EXISTS(id) ((id) > MC_BLOCK_TYPE_AIR)
+
+/*
+ * A bit per block type drawn see-through (with MC_INDICATOR_BLOCK_ALPHA), none of them so far.
+ * Only the opaque blocks are in the chunks' occupancy, so the translucent ones hide nothing behind them,
+ * neither from the mesher nor from the culling.
+ */
+#define MC_BLOCK_TRANSLUCENT_TYPES (0u)
+#define MC_BLOCK_TRANSLUCENT(id) (((id) < 32) && ((MC_BLOCK_TRANSLUCENT_TYPES >> (id)) & 1u))
+#define MC_BLOCK_OPAQUE(id) (MC_BLOCK_EXISTS(id) && !MC_BLOCK_TRANSLUCENT(id))
 
 int mc_block_coord (float xyz);
 
+/*
+ *
+ * Chunk
+ * 
+ */
+
+#define MC_CHUNK_BLOCKS (MC_CHUNK_SIZE * MC_CHUNK_SIZE * MC_CHUNK_SIZE)
+#define MC_CHUNK_MAX_FACES (MC_CHUNK_BLOCKS / 2 * MC_BLOCK_FACES) // every other block, like a 3D checkerboard
+#define MC_CHUNK_MAX_BITS_LOG2 (4) // up to 16 bits per block
+
+// abcde -> a00b00c00d00e
+static inline uint32_t mc_morton_spread (uint32_t v) {
+    v &= 0x000003FF;
+    v = (v | (v << 16)) & 0x030000FF;
+    v = (v | (v <<  8)) & 0x0300F00F;
+    v = (v | (v <<  4)) & 0x030C30C3;
+    v = (v | (v <<  2)) & 0x09249249;
+    return v;
+}
+
+// a00b00c00d00e -> abcde
+static inline uint32_t mc_morton_compact (uint32_t v) {
+    v &= 0x09249249;
+    v = (v | (v >>  2)) & 0x030C30C3;
+    v = (v | (v >>  4)) & 0x0300F00F;
+    v = (v | (v >>  8)) & 0x030000FF;
+    v = (v | (v >> 16)) & 0x000003FF;
+    return v;
+}
+
+static inline uint32_t mc_chunk_idx_linear (int x, int y, int z) {
+    return ((uint32_t)x << (2 * MC_CHUNK_SIZE_LOG2)) | ((uint32_t)y << MC_CHUNK_SIZE_LOG2) | (uint32_t)z;
+}
+
+static inline void mc_chunk_pos_linear (uint32_t idx, int * x, int * y, int * z) {
+    *x = idx >> (2 * MC_CHUNK_SIZE_LOG2);
+    *y = (idx >> MC_CHUNK_SIZE_LOG2) & (MC_CHUNK_SIZE - 1);
+    *z = idx & (MC_CHUNK_SIZE - 1);
+}
+
+static inline uint32_t mc_chunk_idx_morton (int x, int y, int z) {
+    return (mc_morton_spread(x) << 2) | (mc_morton_spread(y) << 1) | mc_morton_spread(z);
+}
+
+static inline void mc_chunk_pos_morton (uint32_t idx, int * x, int * y, int * z) {
+    *x = mc_morton_compact(idx >> 2);
+    *y = mc_morton_compact(idx >> 1);
+    *z = mc_morton_compact(idx);
+}
+
+// bits of a block index holding each coordinate, per layout
+#define MC_CHUNK_LINEAR_MASK_X (0x7C00)
+#define MC_CHUNK_LINEAR_MASK_Y (0x03E0)
+#define MC_CHUNK_LINEAR_MASK_Z (0x001F)
+#define MC_CHUNK_MORTON_MASK_X (0x4924)
+#define MC_CHUNK_MORTON_MASK_Y (0x2492)
+#define MC_CHUNK_MORTON_MASK_Z (0x1249)
+
+/*
+ * Steps a block index by +-1 along the axis given by `mask`, without decoding it (works for both layouts).
+ * Returns MC_FALSE if the neighbour lies outside of the chunk.
+ */
+static inline MC_BOOL mc_chunk_idx_step (uint32_t idx, uint32_t mask, int dir, uint32_t * out) {
+    uint32_t coord = idx & mask;
+    uint32_t lsb = mask & -mask;
+    if (dir > 0) {
+        if (coord == mask)
+            return MC_FALSE;
+        coord = ((coord | ~mask) + lsb) & mask;
+    }
+    else {
+        if (coord == 0)
+            return MC_FALSE;
+        coord = (coord - lsb) & mask;
+    }
+    *out = (idx & ~mask) | coord;
+    return MC_TRUE;
+}
+
+// index of the block at local coordinates (x, y, z), in the layout selected by MC_CHUNK_MORTON
+static inline uint32_t mc_chunk_idx (int x, int y, int z) {
+#if MC_CHUNK_MORTON
+    return mc_chunk_idx_morton(x, y, z);
+#else
+    return mc_chunk_idx_linear(x, y, z);
+#endif
+}
+
+static inline void mc_chunk_pos (uint32_t idx, int * x, int * y, int * z) {
+#if MC_CHUNK_MORTON
+    mc_chunk_pos_morton(idx, x, y, z);
+#else
+    mc_chunk_pos_linear(idx, x, y, z);
+#endif
+}
+
+#if MC_CHUNK_MORTON
+#define MC_CHUNK_MASK_X MC_CHUNK_MORTON_MASK_X
+#define MC_CHUNK_MASK_Y MC_CHUNK_MORTON_MASK_Y
+#define MC_CHUNK_MASK_Z MC_CHUNK_MORTON_MASK_Z
+#else
+#define MC_CHUNK_MASK_X MC_CHUNK_LINEAR_MASK_X
+#define MC_CHUNK_MASK_Y MC_CHUNK_LINEAR_MASK_Y
+#define MC_CHUNK_MASK_Z MC_CHUNK_LINEAR_MASK_Z
+#endif
+
+/*
+ * Blocks are stored as bit-packed indices into a per-chunk palette of block IDs.
+ * The index width is a power of 2 (1, 2, 4, 8 or 16 bits) so an index never straddles two words,
+ * it grows as new block types are placed and shrinks when a type disappears from the chunk.
+ * Uniform chunks (a single block type) have no index array of their own, `data` points to
+ * the shared, read-only mc_chunk_uniform_data and a private copy is made on the first edit.
+ *
+ * Alongside the palette every chunk keeps an occupancy bitmap, 1 bit per block (set if MC_BLOCK_OPAQUE),
+ * as rows of MC_CHUNK_SIZE bits along Z: bit z of occupancy[(x << MC_CHUNK_SIZE_LOG2) | y].
+ * It's updated by mc_chunk_set / mc_chunk_fill and shared between uniform chunks the same way as `data`.
+ */
+_Static_assert(MC_CHUNK_SIZE == 32, "occupancy rows are 32 bit");
+
+#define MC_CHUNK_CELL  (8) // in blocks, see mc_chunk_solid_cells
+#define MC_CHUNK_CELLS (MC_CHUNK_SIZE / MC_CHUNK_CELL) // along each axis
+
+struct mc_Chunk {
+    ivec3 pos; // in chunks
+    mc_BlockID * palette;
+    uint16_t * palette_refs; // how many blocks use each palette entry, 0 if the entry is free
+    uint32_t palette_len; // used and free entries
+    uint32_t palette_used; // entries with palette_refs > 0
+    uint8_t bits_log2; // log2 of the bits per block
+    uint64_t * data;
+    uint32_t * occupancy;
+    uint32_t mesh_first, mesh_faces, mesh_cap; // range of face slots in the world VBO, see mc_world_draw
+    uint32_t mesh_dir_faces[MC_BLOCK_FACES]; // opaque faces of each direction, one after the other from mesh_first
+    uint32_t mesh_translucent; // the faces after the opaque ones, see MC_BLOCK_VERTEX_TRANSLUCENT
+    MC_BOOL dirty; // has to be meshed and uploaded again
+    uint32_t version; // changes whenever the chunk gets dirty, set by the world
+    uint32_t meshing; // the version a mesh is being built of on the stream's workers, 0 if none
+    uint64_t solid_cells; // as of the last time it was meshed, see mc_chunk_solid_cells
+    uint8_t links[MC_BLOCK_FACES]; // as of the last time it was meshed, see mc_chunk_face_links
+    uint32_t visit; // the last draw that reached the chunk, see mc_world_draw
+};
+
+extern const uint64_t mc_chunk_uniform_data[];
+extern const uint32_t mc_chunk_occupancy_empty[];
+extern const uint32_t mc_chunk_occupancy_full[];
+
+/*
+ * The occupancy of the blocks of the 6 neighbouring chunks that touch a chunk, see mc_chunk_border.
+ * Copied from the loaded neighbours on the main thread, so that the chunk can be meshed on another one.
+ */
+struct mc_ChunkBorders {
+    uint32_t rows[MC_BLOCK_FACES][MC_CHUNK_SIZE]; // rows[f] is the layer of the neighbour in the direction f
+};
+
+struct mc_Chunk * mc_chunk_create   (int cx, int cy, int cz);
+struct mc_Chunk * mc_chunk_clone    (const struct mc_Chunk * chunk);
+void              mc_chunk_destroy  (struct mc_Chunk * chunk);
+size_t            mc_chunk_memory   (const struct mc_Chunk * chunk);
+void              mc_chunk_fill     (struct mc_Chunk * chunk, const mc_BlockID * ids);
+void              mc_chunk_set_slow (struct mc_Chunk * chunk, uint32_t idx, mc_BlockID id);
+void              mc_chunk_exposed_faces (const struct mc_Chunk * chunk, const struct mc_Chunk * const neighbours[MC_BLOCK_FACES], int x, uint32_t faces[MC_BLOCK_FACES][MC_CHUNK_SIZE]);
+uint64_t          mc_chunk_solid_cells   (const struct mc_Chunk * chunk);
+void              mc_chunk_face_links    (const struct mc_Chunk * chunk, uint8_t links[MC_BLOCK_FACES]);
+void              mc_chunk_border        (const struct mc_Chunk * chunk, enum mc_BlockFace face, uint32_t rows[MC_CHUNK_SIZE]);
+
+static inline uint32_t mc_chunk_occupancy_row (const struct mc_Chunk * chunk, int x, int y) {
+    return chunk->occupancy[(x << MC_CHUNK_SIZE_LOG2) | y];
+}
+
+static inline MC_BOOL mc_chunk_is_occupied (const struct mc_Chunk * chunk, int x, int y, int z) {
+    return (mc_chunk_occupancy_row(chunk, x, y) >> z) & 1;
+}
+
+static inline void mc_chunk_set_occupied (struct mc_Chunk * chunk, uint32_t idx, MC_BOOL occupied) {
+    int x, y, z;
+    mc_chunk_pos(idx, &x, &y, &z);
+    uint32_t * row = &chunk->occupancy[(x << MC_CHUNK_SIZE_LOG2) | y];
+    *row = (*row & ~(1u << z)) | ((uint32_t)occupied << z);
+}
+
+static inline MC_BOOL mc_chunk_is_uniform (const struct mc_Chunk * chunk) {
+    return chunk->data == mc_chunk_uniform_data;
+}
+
+static inline uint32_t mc_chunk_palette_idx (const struct mc_Chunk * chunk, uint32_t idx) {
+    uint32_t bit = idx << chunk->bits_log2;
+    uint64_t mask = (1ull << (1u << chunk->bits_log2)) - 1;
+    return (uint32_t)((chunk->data[bit >> 6] >> (bit & 63)) & mask);
+}
+
+static inline void mc_chunk_set_palette_idx (struct mc_Chunk * chunk, uint32_t idx, uint32_t palette_idx) {
+    uint32_t bit = idx << chunk->bits_log2;
+    uint64_t mask = (1ull << (1u << chunk->bits_log2)) - 1;
+    uint64_t * word = &chunk->data[bit >> 6];
+    *word = (*word & ~(mask << (bit & 63))) | ((uint64_t)palette_idx << (bit & 63));
+}
+
+static inline mc_BlockID mc_chunk_get (const struct mc_Chunk * chunk, uint32_t idx) {
+    return chunk->palette[mc_chunk_palette_idx(chunk, idx)];
+}
+
+static inline void mc_chunk_set (struct mc_Chunk * chunk, uint32_t idx, mc_BlockID id) {
+    uint32_t old = mc_chunk_palette_idx(chunk, idx);
+    if (chunk->palette[old] == id)
+        return;
+    // fast path, the palette doesn't change
+    if (chunk->palette_refs[old] > 1)
+    for (uint32_t p = 0; p < chunk->palette_len; p++) {
+        if ((chunk->palette[p] == id) && (chunk->palette_refs[p] > 0)) {
+            mc_chunk_set_palette_idx(chunk, idx, p);
+            mc_chunk_set_occupied(chunk, idx, MC_BLOCK_OPAQUE(id));
+            chunk->palette_refs[old]--;
+            chunk->palette_refs[p]++;
+            return;
+        }
+    }
+    mc_chunk_set_slow(chunk, idx, id);
+}
+
+/*
+ *
+ * Chunk Map
+ * Open addressing hash map of the loaded chunks, keyed by chunk coordinates
+ * 
+ */
+
+struct mc_ChunkMap {
+    struct mc_Chunk ** entries; // NULL if the slot is unused
+    size_t cap; // power of 2
+    size_t count;
+};
+
+void              mc_chunkmap_init   (struct mc_ChunkMap * map);
+void              mc_chunkmap_free   (struct mc_ChunkMap * map);
+struct mc_Chunk * mc_chunkmap_get    (struct mc_ChunkMap * map, int cx, int cy, int cz);
+void              mc_chunkmap_insert (struct mc_ChunkMap * map, struct mc_Chunk * chunk);
+void              mc_chunkmap_remove (struct mc_ChunkMap * map, struct mc_Chunk * chunk);
+
+/*
+ *
+ * Mesh
+ * 
+ */
+
+// working memory of mc_mesh_build
+struct mc_MeshScratch {
+    uint64_t columns[MC_CHUNK_SIZE + 2][MC_CHUNK_SIZE + 2]; // padded occupancy columns along Z
+    uint32_t faces[MC_BLOCK_FACES][MC_CHUNK_SIZE][MC_CHUNK_SIZE]; // exposed faces, bit z of faces[f][x][y]
+    uint32_t planes[MC_CHUNK_SIZE][MC_CHUNK_SIZE]; // the faces along Z by depth, for the greedy mesher
+};
+
+struct mc_Mesh {
+    struct mc_FaceRecord * records;
+    struct mc_FaceRecord * translucent; // gathered apart while meshing, then moved to the end of `records`
+    struct mc_BlockVertex * vertices; // MC_BLOCK_FACE_VERTICES per face, see mc_mesh_expand
+    struct mc_MeshScratch * scratch;
+    uint32_t faces, cap;
+    uint32_t dir_faces[MC_BLOCK_FACES]; // the opaque records come grouped by face direction, in this order
+    uint32_t translucent_faces, translucent_cap; // the last translucent_faces of the records
+    uint32_t vertices_cap; // in faces
+};
+
+void mc_mesh_init   (struct mc_Mesh * mesh);
+void mc_mesh_free   (struct mc_Mesh * mesh);
+void mc_mesh_build  (struct mc_Mesh * mesh, const struct mc_Chunk * chunk, const struct mc_ChunkBorders * borders, MC_BOOL greedy);
+void mc_mesh_move   (struct mc_Mesh * dest, struct mc_Mesh * src);
+void mc_mesh_block  (struct mc_Mesh * mesh, mc_BlockID type);
+void mc_mesh_expand (struct mc_Mesh * mesh);
+
+/*
+ *
+ * Stream
+ * 
+ */
+
+enum mc_StreamJobKind {
+    MC_STREAM_JOB_GENERATE, // a new chunk, generated then meshed
+    MC_STREAM_JOB_MESH // a copy of a loaded chunk that changed, meshed again
+};
+
+struct mc_StreamJob {
+    enum mc_StreamJobKind kind;
+    ivec3 pos; // in chunks
+    struct mc_Chunk * chunk; // owned by the job
+    struct mc_ChunkBorders * borders; // of the neighbours as they were when the job was queued, owned by the job
+    MC_BOOL greedy;
+    uint32_t version; // MC_STREAM_JOB_MESH: the chunk's version when it was copied
+    float priority; // lower is built and popped first
+
+    // the results
+    struct mc_Mesh mesh;
+    uint64_t solid_cells;
+    uint8_t links[MC_BLOCK_FACES];
+};
+
+struct mc_Stream {
+    pthread_t threads[MC_STREAM_THREADS];
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    MC_BOOL quit;
+    fnl_state * fnl;
+    vec3 eye, front; // chunks closest to the eye and in front of it are built first
+    struct mc_ChunkMap pending; // the chunks of the MC_STREAM_JOB_GENERATE jobs below, before they're popped
+
+    struct mc_StreamJob * queued; size_t queued_count, queued_cap; // waiting for a worker, a heap
+    struct mc_StreamJob * busy;   size_t busy_count,   busy_cap;   // being built
+    struct mc_StreamJob * done;   size_t done_count,   done_cap;   // waiting for mc_stream_pop, a heap
+};
+
+void    mc_stream_init     (struct mc_Stream * st, fnl_state * fnl);
+void    mc_stream_free     (struct mc_Stream * st);
+void    mc_stream_build    (fnl_state * fnl, struct mc_StreamJob * job, struct mc_Mesh * mesh);
+void    mc_stream_request  (struct mc_Stream * st, int cx, int cy, int cz, struct mc_ChunkBorders * borders, MC_BOOL greedy);
+void    mc_stream_mesh     (struct mc_Stream * st, struct mc_Chunk * chunk, struct mc_ChunkBorders * borders, MC_BOOL greedy, uint32_t version);
+void    mc_stream_release  (struct mc_StreamJob * job);
+void    mc_stream_cancel   (struct mc_Stream * st, const int origin[3], const int size[3]);
+void    mc_stream_set_view (struct mc_Stream * st, vec3 eye, vec3 front);
+MC_BOOL mc_stream_pop      (struct mc_Stream * st, struct mc_StreamJob * job);
+size_t  mc_stream_pending  (struct mc_Stream * st);
+
+/*
+ *
+ * Upload
+ * 
+ */
+
+#define MC_UPLOAD_ALIGN  (16) // every allocation starts at a multiple of this (and of sizeof(struct mc_TextVertex))
+#define MC_UPLOAD_FENCES (8)  // frames that can be in flight, mc_upload_frame waits beyond that
+
+struct mc_UploadFence {
+    GLsync sync;
+    size_t bytes; // what the frame took from the ring, including the skipped end of it
+};
+
+struct mc_UploadRing {
+    GLuint buffer;
+    size_t size;
+    size_t head; // where the next allocation goes
+    size_t used; // from the oldest frame the GPU may still be reading to head
+    size_t frame_bytes, frame_uploads; // since the last mc_upload_frame
+    size_t last_frame_bytes, last_frame_uploads;
+    size_t stalls; // times the CPU waited for the GPU, see mc_upload_stall
+    struct mc_UploadFence fences[MC_UPLOAD_FENCES]; // oldest first
+    size_t fences_count;
+};
+
+void    mc_upload_init     (struct mc_UploadRing * ring, size_t size);
+void    mc_upload_free     (struct mc_UploadRing * ring);
+void  * mc_upload_map      (struct mc_UploadRing * ring, size_t size, GLintptr * offset);
+void  * mc_upload_map_wait (struct mc_UploadRing * ring, size_t size, GLintptr * offset);
+void    mc_upload_unmap    (struct mc_UploadRing * ring);
+void    mc_upload_copy     (struct mc_UploadRing * ring, GLintptr offset, GLuint dst, GLintptr dst_offset, size_t size);
+void    mc_upload_stall    (struct mc_UploadRing * ring);
+void    mc_upload_frame    (struct mc_UploadRing * ring);
+
+/*
+ *
+ * Slots
+ * 
+ */
+
+struct mc_Slots {
+    uint64_t * bits;    // a bit per slot, set if it's in use
+    uint64_t * full;    // a bit per word of `bits`, set if all of its slots are in use
+    uint64_t * any;     // a bit per word of `bits`, set if some of its slots are in use
+    size_t words;       // of `bits`, a multiple of 64
+    uint32_t * longest; // a max tree over the words of `bits`, 2 * leaves long: leaf w is the longest hole starting in word w
+    size_t leaves;      // a power of two, words at least
+    uint32_t top;       // end of the highest run in use
+};
+
+void     mc_slots_init    (struct mc_Slots * slots);
+void     mc_slots_free    (struct mc_Slots * slots);
+uint32_t mc_slots_next    (const struct mc_Slots * slots, uint32_t slot, MC_BOOL used);
+uint32_t mc_slots_find    (const struct mc_Slots * slots, uint32_t count);
+void     mc_slots_take    (struct mc_Slots * slots, uint32_t first, uint32_t count);
+void     mc_slots_release (struct mc_Slots * slots, uint32_t first, uint32_t count);
+
+/*
+ *
+ * Occlusion
+ * 
+ */
+
+#define MC_OCCLUSION_WIDTH  (128)
+#define MC_OCCLUSION_HEIGHT (64)
+#define MC_OCCLUSION_LEVELS (5) // of the min / max pyramid, 128x64 down to 8x4 tiles
+#define MC_OCCLUSION_LANES  (8) // pixels filled at once
+#define MC_OCCLUSION_NEAR   (0.1f) // nearer points (in w) aren't projected, see mc_occlusion_visible
+
+struct mc_Occlusion {
+    float * max[MC_OCCLUSION_LEVELS]; // farthest depth of each tile, max[0] is the depth buffer itself
+    float * min[MC_OCCLUSION_LEVELS]; // nearest depth of each tile, min[0] == max[0]
+    mat4 viewproj;
+    vec3 eye;
+    size_t occluders, quads; // since mc_occlusion_begin
+    MC_BOOL built; // the pyramid is up to date, see mc_occlusion_finish
+};
+
+void    mc_occlusion_init      (struct mc_Occlusion * occ);
+void    mc_occlusion_free      (struct mc_Occlusion * occ);
+void    mc_occlusion_begin     (struct mc_Occlusion * occ, mat4 viewproj, const vec3 eye);
+void    mc_occlusion_add_box   (struct mc_Occlusion * occ, const vec3 min, const vec3 max);
+void    mc_occlusion_add_chunk (struct mc_Occlusion * occ, const struct mc_Chunk * chunk);
+void    mc_occlusion_finish    (struct mc_Occlusion * occ);
+MC_BOOL mc_occlusion_visible   (const struct mc_Occlusion * occ, const vec3 min, const vec3 max);
+
 /*
  *
  * World
@@ -117,29 +577,132 @@ int mc_block_coord (float xyz);
 #define MC_WORLD_MAX_BLOCKS (MC_RENDER_DISTANCE * MC_RENDER_DISTANCE * MC_WORLD_HEIGHT)
 #define MC_WORLD_MAX_FACES (MC_WORLD_MAX_BLOCKS * MC_BLOCK_FACES)
 #define MC_WORLD_MAX_VERTICES (MC_WORLD_MAX_BLOCKS * MC_BLOCK_VERTICES)
+#define MC_WORLD_CHUNKS_XZ (MC_RENDER_DISTANCE / MC_CHUNK_SIZE)
+#define MC_WORLD_CHUNKS_Y  (MC_WORLD_HEIGHT / MC_CHUNK_SIZE)
+
+struct mc_FaceRange {
+    uint32_t first, count;
+};
+
+#define MC_WORLD_FACES_TEXTURE_UNIT (2) // the buffer texture over the VBO when pulling vertices
+#define MC_WORLD_DIRTY_GAP (16) // in faces, dirty ranges closer than this are sent together
+#define MC_WORLD_MIN_VBO_SIZE (1024 * 1024) // in bytes
+#define MC_WORLD_COMPACT_FACES (1 << 16) // how many faces mc_world_draw moves down at most to fill the holes in the VBO
+#define MC_WORLD_OCCLUDER_RANGE (2) // in chunks, the solid cells of the chunks this close to the camera's are occluders
+#define MC_WORLD_SAMPLE_QUERIES (4) // frames the sample counts are read back after, so that reading them doesn't wait
+
+// totals since mc_world_init of what the chunks sent to the GPU
+struct mc_WorldUploadStats {
+    size_t meshed_bytes; // the meshes of the chunks, what sending every mesh whole would take
+    size_t runs; // runs of face slots that changed, a transfer each if they weren't merged
+    size_t run_bytes;
+    size_t copies; // transfers actually made
+    size_t bytes; // sent, the gaps between merged runs included
+};
+
+// a chunk reached by the search in mc_world_draw
+struct mc_ChunkVisit {
+    struct mc_Chunk * chunk;
+    uint8_t from; // the face it was entered through, MC_BLOCK_FACES for the camera's chunk
+    uint8_t dirs; // bit f is set if the way there went through face f of some chunk
+};
+
+struct mc_ChunkDepth {
+    float depth; // squared distance from the camera to the centre of the chunk, in blocks
+    struct mc_Chunk * chunk;
+};
+
+// what the last mc_world_draw did with the chunks
+struct mc_WorldCullStats {
+    size_t chunks; // that have faces
+    size_t cave_culled; // not reachable from the camera's chunk through empty blocks
+    size_t frustum_culled;
+    size_t occlusion_culled;
+    size_t occluders; // boxes rasterized
+    size_t drawn;
+    size_t drawn_faces;
+    size_t facing_away; // faces of the drawn chunks left out because the camera is behind their plane
+    size_t translucent; // chunks drawn again for their translucent faces
+    size_t samples; // that passed the depth test while drawing the opaque faces, a few frames ago
+};
 
 struct mc_World {
 	GLuint VAO, VBO;
-    ivec3 offset;
-	struct mc_Block * blocks;
+    GLuint EBO; // the indices of MC_CHUNK_MAX_FACES quads, shared by all chunks
+    GLuint pull_VAO; // no attributes, the vertex shader reads the face records from faces_tex
+    GLuint faces_tex; // GL_TEXTURE_BUFFER over the VBO
+    ivec3 offset; // in blocks
+    struct mc_ChunkMap chunks;
     fnl_state fnl;
-
-    GLintptr face_indices_top;
-    GLintptr * free_face_indices;
-    GLintptr free_face_indices_top;
+    struct mc_Stream stream;
+    MC_BOOL following; // the window has been placed around the camera
+    MC_BOOL greedy; // merge coplanar faces of the same type, see mc_world_set_greedy
+    MC_BOOL pulling; // the VBO holds face records instead of vertices, see mc_world_set_pulling
+
+    size_t vbo_size; // in bytes, grows and shrinks with slots.top
+    size_t vbo_resizes;
+    struct mc_Slots slots; // a slot per face of the VBO, slots.top is the end of the used part
+    size_t faces_count; // in use
+    struct mc_Mesh mesh; // main thread only, for the indicator and mc_world_mesh_chunk
+    uint32_t versions; // the last mc_Chunk.version handed out
+    struct mc_UploadRing * upload; // not owned
+    size_t upload_bytes; // written by mc_world_update this frame, at most MC_WORLD_UPLOAD_BUDGET
+
+    // CPU copy of the VBO, the chunks are written here and the GPU is brought up to date once per draw
+    unsigned char * shadow; // vbo_size bytes
+    size_t shadow_valid; // in bytes, what's past it has never been sent and can't be compared against
+    struct mc_FaceRange * dirty_ranges; // face slots of the shadow not sent yet, unsorted
+    size_t dirty_ranges_count, dirty_ranges_cap;
+    struct mc_WorldUploadStats upload_stats;
+
+    // the chunks mc_world_draw submits, gathered and culled on every draw
+    struct mc_Chunk ** draw_list;
+    size_t draw_count, draw_cap; // draw_cap is a multiple of MC_FRUSTUM_LANES
+    float * draw_boxes; // 6 arrays of draw_cap floats, the bounds of the chunks in world units (see mc_frustum_cull)
+    uint8_t * draw_visible;
+    struct mc_ChunkDepth * draw_depths; // 2 * draw_cap, for sorting draw_list
+    MC_BOOL front_to_back; // sorts draw_list by distance before drawing it, otherwise it's left in search order
+    struct mc_ChunkVisit * visits; // the queue of the search through the chunks
+    size_t visits_cap;
+    uint32_t draws; // counts the calls to mc_world_draw, see mc_Chunk.visit
+    struct mc_ChunkDepth * translucent; // the chunks of draw_list with translucent faces, front to back
+    size_t translucent_count, translucent_cap; // the array holds twice translucent_cap, for sorting
+    GLuint sample_queries[MC_WORLD_SAMPLE_QUERIES]; // GL_SAMPLES_PASSED by the opaque faces, one per frame in turn
+    size_t sample_frames;
+    struct mc_Occlusion occlusion;
+    struct mc_WorldCullStats cull_stats;
+
+    // a block drawn see-through at indicator_pos after the translucent faces, see mc_world_set_indicator
+    mc_BlockID indicator; // MC_BLOCK_TYPE_NONE if none
+    ivec3 indicator_pos; // in blocks
+    uint32_t indicator_first; // MC_BLOCK_FACES face slots
+    mc_BlockID indicator_written; // whose faces are in the slots, MC_BLOCK_TYPE_NONE after they changed size
 };
 
-void mc_world_init (struct mc_World * wd, size_t reserved_blocks_count);
+void mc_world_init (struct mc_World * wd, size_t reserved_blocks_count, struct mc_UploadRing * upload);
 void mc_world_free (struct mc_World * wd);
-void mc_world_draw (struct mc_World * wd, GLint block_index, GLsizei block_count);
-
-void             mc_world_move                 (struct mc_World * wd, int x, int y, int z);
-struct mc_Block* mc_world_block_at             (struct mc_World * wd, int x, int y, int z);
-void             mc_world_destroy_block_at     (struct mc_World * wd, int x, int y, int z);
-void             mc_world_place_block_at       (struct mc_World * wd, int x, int y, int z, enum mc_BlockType type);
-
-void             mc_world_destroy_block_at_idx (struct mc_World * wd, int ix, int iy, int iz, int x, int y, int z);
-void             mc_world_place_block_at_idx   (struct mc_World * wd, int ix, int iy, int iz, int x, int y, int z, enum mc_BlockType type);
+void mc_world_draw (struct mc_World * wd, GLuint prog, mat4 viewproj, vec3 eye);
+
+size_t mc_world_blocks_memory   (struct mc_World * wd);
+size_t mc_world_mesh_memory     (struct mc_World * wd);
+size_t mc_world_vertices_memory (struct mc_World * wd);
+size_t mc_world_vertices_used   (struct mc_World * wd);
+
+void              mc_world_move             (struct mc_World * wd, int dx, int dy, int dz);
+void              mc_world_follow           (struct mc_World * wd, vec3 eye, vec3 front, vec3 velocity);
+void              mc_world_update           (struct mc_World * wd, size_t max_chunks);
+mc_BlockID        mc_world_block_at         (struct mc_World * wd, int x, int y, int z);
+void              mc_world_destroy_block_at (struct mc_World * wd, int x, int y, int z);
+void              mc_world_place_block_at   (struct mc_World * wd, int x, int y, int z, enum mc_BlockType type);
+MC_BOOL           mc_world_is_occupied      (struct mc_World * wd, int x, int y, int z);
+
+struct mc_Chunk * mc_world_chunk_at         (struct mc_World * wd, int cx, int cy, int cz);
+struct mc_Chunk * mc_world_load_chunk       (struct mc_World * wd, int cx, int cy, int cz);
+void              mc_world_unload_chunk     (struct mc_World * wd, struct mc_Chunk * chunk);
+void              mc_world_mesh_chunk       (struct mc_World * wd, struct mc_Chunk * chunk);
+void              mc_world_set_greedy       (struct mc_World * wd, MC_BOOL greedy);
+void              mc_world_set_pulling      (struct mc_World * wd, MC_BOOL pulling);
+void              mc_world_set_indicator    (struct mc_World * wd, int x, int y, int z, mc_BlockID type);
 
 /*
  *
@@ -178,11 +741,12 @@ struct mc_TextVertex {
     float tx, ty; // texture coords
 };
 struct mc_TextRenderer {
-    GLuint VAO, VBO, prog;
+    GLuint VAO, prog;
     struct mc_Texture font;
+    struct mc_UploadRing * upload; // the vertices are drawn straight from the ring, not owned
 };
 
-void mc_textr_create  (struct mc_TextRenderer *textr);
+void mc_textr_create  (struct mc_TextRenderer *textr, struct mc_UploadRing * upload);
 void mc_textr_draw    (struct mc_TextRenderer *textr, float x, float y, const char * src);
 void mc_textr_destroy (struct mc_TextRenderer *textr);
 
@@ -0,0 +1,409 @@
+/*
+ *
+ * Chunk meshing
+ * Builds the faces of a chunk into a CPU side array of face records, no OpenGL calls in here
+ * Either a face per exposed block face, or greedy: maximal rectangles of coplanar faces of the same block type
+ * The records are either sent as they are (and expanded by the vertex shader) or turned into vertices by mc_mesh_expand
+ *
+ */
+
+#include "mc.h"
+
+#include <stdlib.h>
+
+#define MC_MESH_INITIAL_CAP (1024) // in faces
+
+// indices into the block texture atlas (see main.c) of every face of every block type
+static const uint8_t block_textures[][MC_BLOCK_FACES] = {
+    [MC_BLOCK_TYPE_GRASS] = {
+        [MC_BLOCK_FACE_LEFT  ] = 0, [MC_BLOCK_FACE_RIGHT] = 0,
+        [MC_BLOCK_FACE_BOTTOM] = 2, [MC_BLOCK_FACE_TOP  ] = 1,
+        [MC_BLOCK_FACE_BACK  ] = 0, [MC_BLOCK_FACE_FRONT] = 0
+    }
+};
+
+// the corner of the box every vertex of a face lies on, 0 - min, 1 - max along x, y, z, in the order of the quad indices
+static const uint8_t face_corners[MC_BLOCK_FACES][MC_BLOCK_FACE_VERTICES][3] = {
+    [MC_BLOCK_FACE_LEFT  ] = {{0,1,1}, {0,1,0}, {0,0,0}, {0,0,1}},
+    [MC_BLOCK_FACE_RIGHT ] = {{1,0,0}, {1,1,0}, {1,1,1}, {1,0,1}},
+    [MC_BLOCK_FACE_BOTTOM] = {{0,0,0}, {1,0,0}, {1,0,1}, {0,0,1}},
+    [MC_BLOCK_FACE_TOP   ] = {{1,1,1}, {1,1,0}, {0,1,0}, {0,1,1}},
+    [MC_BLOCK_FACE_BACK  ] = {{1,1,0}, {1,0,0}, {0,0,0}, {0,1,0}},
+    [MC_BLOCK_FACE_FRONT ] = {{0,0,1}, {1,0,1}, {1,1,1}, {0,1,1}}
+};
+
+// the axes along the rows and along the bits of the planes the faces are merged in, by face normal axis
+static const uint8_t plane_axes[3][2] = {{1, 2}, {0, 2}, {0, 1}};
+
+static void reserve_records (struct mc_FaceRecord ** records, uint32_t * cap, uint32_t count) {
+    assert(records != NULL);
+    assert(cap != NULL);
+    if (count <= *cap)
+        return;
+    *cap = MC_MAX(count, (*cap == 0) ? MC_MESH_INITIAL_CAP : *cap * 2);
+    *records = realloc(*records, sizeof(**records) * *cap);
+    assert(*records != NULL);
+}
+
+/*
+ * Adds the face `face` of the box of size[0] x size[1] x size[2] blocks whose lowest block is at l (local),
+ * translucent faces are kept apart until mc_mesh_build puts them after the opaque ones.
+ */
+static void add_face (struct mc_Mesh * mesh, mc_BlockID type, enum mc_BlockFace face, const int l[3], const int size[3], MC_BOOL translucent) {
+    assert(mesh != NULL);
+    struct mc_FaceRecord * record;
+    uint32_t flags = 0;
+    if (translucent) {
+        reserve_records(&mesh->translucent, &mesh->translucent_cap, mesh->translucent_faces + 1);
+        record = &mesh->translucent[mesh->translucent_faces++];
+        flags = MC_BLOCK_VERTEX_TRANSLUCENT;
+    }
+    else {
+        reserve_records(&mesh->records, &mesh->cap, mesh->faces + 1);
+        record = &mesh->records[mesh->faces++];
+        mesh->dir_faces[face]++;
+    }
+    // the atlas is flipped on load, its first texture ends up in the last layer
+    uint32_t layer = MC_BLOCKTEX_BLOCKS - 1 - block_textures[type][face];
+    record->data = MC_BLOCK_VERTEX_PACK(l[0], l[1], l[2], face, layer, flags);
+    record->size = MC_FACE_RECORD_SIZE(size[0], size[1], size[2]);
+}
+
+static inline mc_BlockID plane_block (const struct mc_Chunk * chunk, enum mc_BlockFace face, int d, int r, int c) {
+    int l[3];
+    l[face / 2] = d;
+    l[plane_axes[face / 2][0]] = r;
+    l[plane_axes[face / 2][1]] = c;
+    return mc_chunk_get(chunk, mc_chunk_idx(l[0], l[1], l[2]));
+}
+
+// how many of the `w` faces from column c on in row r are of block type `type`
+static inline int type_run (const struct mc_Chunk * chunk, enum mc_BlockFace face, int d, int r, int c, int w, mc_BlockID type) {
+    int n = 0;
+    while ((n < w) && (plane_block(chunk, face, d, r, c + n) == type))
+        n++;
+    return n;
+}
+
+/*
+ * Merges the faces in a plane into rectangles, bit c of plane[r] is set if the face at row r, column c is exposed
+ * and bit r of `rows` if plane[r] has any. Every rectangle is first widened along its row, then grown over
+ * the following rows, both a word at a time. Unless the chunk only has the block type `single` the runs found
+ * that way are then cut short at the first face of another type.
+ */
+static void mesh_plane_greedy (struct mc_Mesh * mesh, const struct mc_Chunk * chunk, enum mc_BlockFace face, int d, uint32_t plane[MC_CHUNK_SIZE], uint32_t rows, mc_BlockID single) {
+    assert(mesh != NULL);
+    assert(chunk != NULL);
+    MC_BOOL mixed = (single == MC_BLOCK_TYPE_NONE);
+    for (; rows != 0; rows &= rows - 1) {
+        int r = __builtin_ctz(rows);
+        while (plane[r] != 0) {
+            int c = __builtin_ctz(plane[r]);
+            mc_BlockID type = mixed ? plane_block(chunk, face, d, r, c) : single;
+
+            // the faces right after it, the topmost bit is always clear so ~ext can't be 0
+            uint32_t ext = (c < MC_CHUNK_SIZE - 1) ? (plane[r] >> (c + 1)) : 0;
+            int w = 1 + __builtin_ctz(~ext);
+            if (mixed)
+                w = 1 + type_run(chunk, face, d, r, c + 1, w - 1, type);
+            uint32_t run = ((w == MC_CHUNK_SIZE) ? UINT32_MAX : ((1u << w) - 1)) << c;
+
+            int h = 1;
+            while ((r + h < MC_CHUNK_SIZE) && ((plane[r + h] & run) == run) && (!mixed || (type_run(chunk, face, d, r + h, c, w, type) == w)))
+                h++;
+            for (int i = 0; i < h; i++)
+                plane[r + i] &= ~run;
+
+            int l[3];
+            int size[3] = {1, 1, 1};
+            l[face / 2] = d;
+            l[plane_axes[face / 2][0]] = r;
+            l[plane_axes[face / 2][1]] = c;
+            size[plane_axes[face / 2][0]] = h;
+            size[plane_axes[face / 2][1]] = w;
+            add_face(mesh, type, face, l, size, MC_BLOCK_TRANSLUCENT(type));
+        }
+    }
+}
+
+static inline uint64_t padded_column (uint32_t row, uint32_t before, uint32_t after) {
+    return ((uint64_t)row << 1) | before | ((uint64_t)after << (MC_CHUNK_SIZE + 1));
+}
+
+/*
+ * Fills s->columns, the occupancy of the chunk as columns along Z padded with a block on both ends
+ * (bit 0 - the block in the chunk behind, bits 1 .. MC_CHUNK_SIZE - the chunk, bit MC_CHUNK_SIZE + 1 - the chunk in front)
+ * and surrounded by the columns of the chunks on the 4 other sides, columns[x + 1][y + 1] holds the column at (x, y).
+ */
+static void build_columns (struct mc_MeshScratch * s, const struct mc_Chunk * chunk, const struct mc_ChunkBorders * borders) {
+    assert(s != NULL);
+    assert(chunk != NULL);
+    assert(borders != NULL);
+    for (int x = 0; x < MC_CHUNK_SIZE; x++)
+    for (int y = 0; y < MC_CHUNK_SIZE; y++)
+        s->columns[x + 1][y + 1] = padded_column(
+            mc_chunk_occupancy_row(chunk, x, y),
+            (borders->rows[MC_BLOCK_FACE_BACK][x] >> y) & 1,
+            (borders->rows[MC_BLOCK_FACE_FRONT][x] >> y) & 1
+        );
+
+    // only the blocks inside the chunk's own Z range are ever compared with these
+    for (int i = 0; i < MC_CHUNK_SIZE; i++) {
+        s->columns[0][i + 1]                 = padded_column(borders->rows[MC_BLOCK_FACE_LEFT][i],   0, 0);
+        s->columns[MC_CHUNK_SIZE + 1][i + 1] = padded_column(borders->rows[MC_BLOCK_FACE_RIGHT][i],  0, 0);
+        s->columns[i + 1][0]                 = padded_column(borders->rows[MC_BLOCK_FACE_BOTTOM][i], 0, 0);
+        s->columns[i + 1][MC_CHUNK_SIZE + 1] = padded_column(borders->rows[MC_BLOCK_FACE_TOP][i],    0, 0);
+    }
+}
+
+// the faces of the blocks in `col`, padded like s->columns, at (x, y) that aren't against an opaque block
+static inline void column_faces (struct mc_MeshScratch * s, int x, int y, uint64_t col) {
+    uint64_t own = s->columns[x + 1][y + 1];
+    s->faces[MC_BLOCK_FACE_LEFT  ][x][y] = (uint32_t)((col & ~s->columns[x    ][y + 1]) >> 1);
+    s->faces[MC_BLOCK_FACE_RIGHT ][x][y] = (uint32_t)((col & ~s->columns[x + 2][y + 1]) >> 1);
+    s->faces[MC_BLOCK_FACE_BOTTOM][x][y] = (uint32_t)((col & ~s->columns[x + 1][y    ]) >> 1);
+    s->faces[MC_BLOCK_FACE_TOP   ][x][y] = (uint32_t)((col & ~s->columns[x + 1][y + 2]) >> 1);
+    s->faces[MC_BLOCK_FACE_BACK  ][x][y] = (uint32_t)((col & ~(own << 1)) >> 1);
+    s->faces[MC_BLOCK_FACE_FRONT ][x][y] = (uint32_t)((col & ~(own >> 1)) >> 1);
+}
+
+/*
+ * The exposed faces of every column at once: a block has a face towards a neighbour that's empty,
+ * along Z that's the column shifted by one, along X and Y the neighbouring column.
+ */
+static void build_faces (struct mc_MeshScratch * s) {
+    assert(s != NULL);
+    for (int x = 0; x < MC_CHUNK_SIZE; x++)
+    for (int y = 0; y < MC_CHUNK_SIZE; y++)
+        column_faces(s, x, y, s->columns[x + 1][y + 1]);
+}
+
+/*
+ * The same for the translucent blocks, which aren't in the occupancy and have to be looked up one by one.
+ * Their faces are exposed towards everything that isn't opaque, other translucent blocks included.
+ */
+static void build_translucent_faces (struct mc_MeshScratch * s, const struct mc_Chunk * chunk) {
+    assert(s != NULL);
+    assert(chunk != NULL);
+    for (int x = 0; x < MC_CHUNK_SIZE; x++)
+    for (int y = 0; y < MC_CHUNK_SIZE; y++) {
+        uint32_t row = 0;
+        for (int z = 0; z < MC_CHUNK_SIZE; z++)
+            row |= (uint32_t)MC_BLOCK_TRANSLUCENT(mc_chunk_get(chunk, mc_chunk_idx(x, y, z))) << z;
+        column_faces(s, x, y, padded_column(row, 0, 0));
+    }
+}
+
+// bit r is set if plane[r] has any faces
+static inline uint32_t plane_rows (const uint32_t plane[MC_CHUNK_SIZE]) {
+    uint32_t rows = 0;
+    for (int r = 0; r < MC_CHUNK_SIZE; r++)
+        rows |= (uint32_t)(plane[r] != 0) << r;
+    return rows;
+}
+
+/*
+ * The planes along X are slices of s->faces as they are, the ones along Y are gathered a word per row
+ * and the faces along Z are scattered bit by bit (there are few of them, and only the set bits are visited).
+ */
+static void mesh_greedy (struct mc_Mesh * mesh, const struct mc_Chunk * chunk, mc_BlockID single) {
+    assert(mesh != NULL);
+    assert(chunk != NULL);
+    struct mc_MeshScratch * s = mesh->scratch;
+    for (int f = 0; f < MC_BLOCK_FACES; f++) {
+        uint32_t (*faces)[MC_CHUNK_SIZE] = s->faces[f];
+        switch (f / 2) {
+        case 0:
+            for (int d = 0; d < MC_CHUNK_SIZE; d++) {
+                uint32_t rows = plane_rows(faces[d]);
+                if (rows != 0)
+                    mesh_plane_greedy(mesh, chunk, f, d, faces[d], rows, single);
+            }
+            break;
+        case 1:
+            for (int d = 0; d < MC_CHUNK_SIZE; d++) {
+                uint32_t plane[MC_CHUNK_SIZE];
+                for (int x = 0; x < MC_CHUNK_SIZE; x++)
+                    plane[x] = faces[x][d];
+                uint32_t rows = plane_rows(plane);
+                if (rows != 0)
+                    mesh_plane_greedy(mesh, chunk, f, d, plane, rows, single);
+            }
+            break;
+        default: {
+            uint32_t depths = 0;
+            memset(s->planes, 0, sizeof(s->planes));
+            for (int x = 0; x < MC_CHUNK_SIZE; x++)
+            for (int y = 0; y < MC_CHUNK_SIZE; y++) {
+                uint32_t m = faces[x][y];
+                depths |= m;
+                while (m != 0) {
+                    s->planes[__builtin_ctz(m)][x] |= 1u << y;
+                    m &= m - 1;
+                }
+            }
+            while (depths != 0) {
+                int d = __builtin_ctz(depths);
+                depths &= depths - 1;
+                mesh_plane_greedy(mesh, chunk, f, d, s->planes[d], plane_rows(s->planes[d]), single);
+            }
+        }
+        }
+    }
+}
+
+static void mesh_faces (struct mc_Mesh * mesh, const struct mc_Chunk * chunk, mc_BlockID single) {
+    assert(mesh != NULL);
+    assert(chunk != NULL);
+    static const int size[3] = {1, 1, 1};
+    struct mc_MeshScratch * s = mesh->scratch;
+    for (int f = 0; f < MC_BLOCK_FACES; f++)
+    for (int x = 0; x < MC_CHUNK_SIZE; x++)
+    for (int y = 0; y < MC_CHUNK_SIZE; y++) {
+        uint32_t m = s->faces[f][x][y];
+        while (m != 0) {
+            int l[3] = {x, y, __builtin_ctz(m)};
+            m &= m - 1;
+            mc_BlockID type = (single != MC_BLOCK_TYPE_NONE) ? single : mc_chunk_get(chunk, mc_chunk_idx(l[0], l[1], l[2]));
+            add_face(mesh, type, f, l, size, MC_BLOCK_TRANSLUCENT(type));
+        }
+    }
+}
+
+// moves the translucent faces after the opaque ones
+static void append_translucent (struct mc_Mesh * mesh) {
+    assert(mesh != NULL);
+    if (mesh->translucent_faces == 0)
+        return;
+    reserve_records(&mesh->records, &mesh->cap, mesh->faces + mesh->translucent_faces);
+    memcpy(&mesh->records[mesh->faces], mesh->translucent, sizeof(*mesh->records) * mesh->translucent_faces);
+    mesh->faces += mesh->translucent_faces;
+}
+
+/*============================================================================================================
+ *
+ *
+ *
+ *==========================================================================================================*/
+
+void mc_mesh_init (struct mc_Mesh * mesh) {
+    assert(mesh != NULL);
+    mesh->records = NULL;
+    mesh->translucent = NULL;
+    mesh->vertices = NULL;
+    mesh->scratch = NULL;
+    mesh->faces = 0;
+    mesh->cap = 0;
+    memset(mesh->dir_faces, 0, sizeof(mesh->dir_faces));
+    mesh->translucent_faces = 0;
+    mesh->translucent_cap = 0;
+    mesh->vertices_cap = 0;
+}
+
+void mc_mesh_free (struct mc_Mesh * mesh) {
+    assert(mesh != NULL);
+    free(mesh->records);
+    free(mesh->translucent);
+    free(mesh->vertices);
+    free(mesh->scratch);
+    mc_mesh_init(mesh);
+}
+
+/*
+ * Replaces the contents of `mesh` with the faces of `chunk`, against the blocks of its neighbours in `borders`.
+ * The chunk is turned into padded 64 bit columns along Z, the exposed faces of a whole column come out of
+ * a shift or of the neighbouring column and an AND, and the greedy mesher merges them a bit plane at a time.
+ */
+void mc_mesh_build (struct mc_Mesh * mesh, const struct mc_Chunk * chunk, const struct mc_ChunkBorders * borders, MC_BOOL greedy) {
+    assert(mesh != NULL);
+    assert(chunk != NULL);
+    assert(borders != NULL);
+    mesh->faces = 0;
+    memset(mesh->dir_faces, 0, sizeof(mesh->dir_faces));
+    mesh->translucent_faces = 0;
+
+    // chunks with a single block type don't need to look the types up
+    mc_BlockID single = MC_BLOCK_TYPE_NONE;
+    uint32_t types = 0;
+    MC_BOOL translucent = MC_FALSE;
+    for (uint32_t i = 0; i < chunk->palette_len; i++) {
+        if ((chunk->palette_refs[i] > 0) && MC_BLOCK_EXISTS(chunk->palette[i])) {
+            single = chunk->palette[i];
+            types++;
+            translucent |= MC_BLOCK_TRANSLUCENT(single);
+        }
+    }
+    if (types > 1)
+        single = MC_BLOCK_TYPE_NONE;
+    if ((chunk->occupancy == mc_chunk_occupancy_empty) && !translucent)
+        return;
+    if (mesh->scratch == NULL) {
+        mesh->scratch = malloc(sizeof(*mesh->scratch));
+        assert(mesh->scratch != NULL);
+    }
+
+    build_columns(mesh->scratch, chunk, borders);
+    build_faces(mesh->scratch);
+    if (greedy)
+        mesh_greedy(mesh, chunk, single);
+    else
+        mesh_faces(mesh, chunk, single);
+    if (!translucent)
+        return;
+
+    build_translucent_faces(mesh->scratch, chunk);
+    if (greedy)
+        mesh_greedy(mesh, chunk, single);
+    else
+        mesh_faces(mesh, chunk, single);
+    append_translucent(mesh);
+}
+
+// hands the faces of `src` over to `dest`, `src` is left empty and keeps its scratch memory
+void mc_mesh_move (struct mc_Mesh * dest, struct mc_Mesh * src) {
+    assert(dest != NULL);
+    assert(src != NULL);
+    struct mc_MeshScratch * scratch = src->scratch;
+    mc_mesh_free(dest);
+    *dest = *src;
+    dest->scratch = NULL;
+    mc_mesh_init(src);
+    src->scratch = scratch;
+}
+
+/*
+ * Replaces the contents of `mesh` with the six faces of a lone block of `type` at the chunk origin,
+ * all of them translucent whatever the type, for the block indicator (see mc_world_set_indicator).
+ */
+void mc_mesh_block (struct mc_Mesh * mesh, mc_BlockID type) {
+    assert(mesh != NULL);
+    assert(MC_BLOCK_EXISTS(type));
+    static const int l[3] = {0, 0, 0}, size[3] = {1, 1, 1};
+    mesh->faces = 0;
+    memset(mesh->dir_faces, 0, sizeof(mesh->dir_faces));
+    mesh->translucent_faces = 0;
+    for (int f = 0; f < MC_BLOCK_FACES; f++)
+        add_face(mesh, type, f, l, size, MC_TRUE);
+    append_translucent(mesh);
+}
+
+// fills mesh->vertices with MC_BLOCK_FACE_VERTICES vertices for every face record
+void mc_mesh_expand (struct mc_Mesh * mesh) {
+    assert(mesh != NULL);
+    if (mesh->vertices_cap < mesh->cap) {
+        mesh->vertices_cap = mesh->cap;
+        mesh->vertices = realloc(mesh->vertices, sizeof(*mesh->vertices) * MC_BLOCK_FACE_VERTICES * mesh->vertices_cap);
+        assert(mesh->vertices != NULL);
+    }
+    for (uint32_t i = 0; i < mesh->faces; i++) {
+        const struct mc_FaceRecord * record = &mesh->records[i];
+        uint32_t pos = record->data & MC_FACE_RECORD_POS_MASK;
+        uint32_t face = (record->data >> 18) & 7;
+        for (int v = 0; v < MC_BLOCK_FACE_VERTICES; v++) {
+            const uint8_t * c = face_corners[face][v];
+            // the position of the corner fits into the bits of the lowest one, adding the size can't carry over
+            uint32_t ofs = c[0] * (record->size & 63) | c[1] * (record->size & (63 << 6)) | c[2] * (record->size & (63 << 12));
+            mesh->vertices[i * MC_BLOCK_FACE_VERTICES + v].data = (record->data & ~MC_FACE_RECORD_POS_MASK) | (pos + ofs);
+        }
+    }
+}
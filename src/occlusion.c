@@ -0,0 +1,270 @@
+/*
+ *
+ * Occlusion
+ * A small software depth buffer the nearby solid geometry is rasterized into on the CPU, no GL involved.
+ * Depths are clip space w (the distance along the view direction), each pixel keeps the nearest occluder.
+ * Occluders only ever make the buffer nearer than the real scene where they really are:
+ * every face is written at the depth of its farthest corner, into the pixels it covers completely.
+ * A min / max pyramid over the buffer then lets a box be tested against a few tiles instead of all its pixels.
+ *
+ */
+
+#include "mc.h"
+
+#include <math.h>
+
+typedef float mc_Lanes __attribute__((vector_size(MC_OCCLUSION_LANES * sizeof(float))));
+typedef int32_t mc_LaneMask __attribute__((vector_size(MC_OCCLUSION_LANES * sizeof(int32_t))));
+
+_Static_assert(MC_OCCLUSION_WIDTH % MC_OCCLUSION_LANES == 0, "rows are filled a lane group at a time");
+_Static_assert(((MC_OCCLUSION_WIDTH >> (MC_OCCLUSION_LEVELS - 1)) << (MC_OCCLUSION_LEVELS - 1)) == MC_OCCLUSION_WIDTH, "every level halves the one below");
+_Static_assert(((MC_OCCLUSION_HEIGHT >> (MC_OCCLUSION_LEVELS - 1)) << (MC_OCCLUSION_LEVELS - 1)) == MC_OCCLUSION_HEIGHT, "every level halves the one below");
+
+static inline int level_width  (int level) { return MC_OCCLUSION_WIDTH  >> level; }
+static inline int level_height (int level) { return MC_OCCLUSION_HEIGHT >> level; }
+
+// `p` in pixels (x, y) and its w, MC_FALSE if it's behind the near plane
+static MC_BOOL project (const struct mc_Occlusion * occ, const vec3 p, vec3 dest) {
+    assert(occ != NULL);
+    vec4 clip;
+    glm_mat4_mulv((vec4 *)occ->viewproj, (vec4){p[0], p[1], p[2], 1.0f}, clip);
+    if (clip[3] < MC_OCCLUSION_NEAR)
+        return MC_FALSE;
+    dest[0] = (clip[0] / clip[3] * 0.5f + 0.5f) * MC_OCCLUSION_WIDTH;
+    dest[1] = (clip[1] / clip[3] * 0.5f + 0.5f) * MC_OCCLUSION_HEIGHT;
+    dest[2] = clip[3];
+    return MC_TRUE;
+}
+
+/*
+ * Fills the convex quad q (in pixels, either winding) at the depth `w`, where it's nearer than what's there.
+ * Only the pixels the quad covers completely are written, so gaps between occluders never get closed.
+ */
+static void fill_quad (struct mc_Occlusion * occ, const vec3 q[4], float w) {
+    assert(occ != NULL);
+    float area = 0.0f;
+    for (int i = 0; i < 4; i++)
+        area += q[i][0] * q[(i + 1) % 4][1] - q[(i + 1) % 4][0] * q[i][1];
+    if (fabsf(area) < 1.0f)
+        return; // can't cover a whole pixel
+    float sign = (area > 0.0f) ? 1.0f : -1.0f;
+
+    // edge i is inside where a * x + b * y + c >= 0
+    float a[4], b[4], c[4];
+    float x0 = q[0][0], x1 = q[0][0], y0 = q[0][1], y1 = q[0][1];
+    for (int i = 0; i < 4; i++) {
+        const float * p = q[i], * n = q[(i + 1) % 4];
+        a[i] = sign * (p[1] - n[1]);
+        b[i] = sign * (n[0] - p[0]);
+        c[i] = -(a[i] * p[0] + b[i] * p[1]);
+        x0 = MC_MIN(x0, p[0]); x1 = MC_MAX(x1, p[0]);
+        y0 = MC_MIN(y0, p[1]); y1 = MC_MAX(y1, p[1]);
+    }
+    int px0 = MC_MAX(0, (int)ceilf(x0)), px1 = MC_MIN(MC_OCCLUSION_WIDTH  - 1, (int)floorf(x1) - 1);
+    int py0 = MC_MAX(0, (int)ceilf(y0)), py1 = MC_MIN(MC_OCCLUSION_HEIGHT - 1, (int)floorf(y1) - 1);
+    if ((px0 > px1) || (py0 > py1))
+        return;
+    occ->quads++;
+
+    // each row is filled between where both of its edges (y and y + 1) are inside the quad, whole pixels only
+    mc_Lanes lane;
+    for (int l = 0; l < MC_OCCLUSION_LANES; l++)
+        lane[l] = l;
+    mc_Lanes depth = (mc_Lanes){0} + w;
+    for (int y = py0; y <= py1; y++) {
+        float xl = x0, xr = x1;
+        for (int i = 0; i < 4; i++) {
+            float k = MC_MIN(b[i] * y, b[i] * (y + 1)) + c[i];
+            if (a[i] > 0.0f)
+                xl = MC_MAX(xl, -k / a[i]);
+            else if (a[i] < 0.0f)
+                xr = MC_MIN(xr, -k / a[i]);
+            else if (k < 0.0f)
+                xr = -1.0f;
+        }
+        int l = MC_MAX(px0, (int)ceilf(xl)), r = MC_MIN(px1, (int)floorf(xr) - 1);
+        if (l > r)
+            continue;
+        float * row = &occ->max[0][y * MC_OCCLUSION_WIDTH];
+        for (int x = l & ~(MC_OCCLUSION_LANES - 1); x <= r; x += MC_OCCLUSION_LANES) {
+            mc_Lanes px = lane + (float)x;
+            mc_Lanes cur;
+            memcpy(&cur, &row[x], sizeof(cur));
+            mc_LaneMask take = (px >= (float)l) & (px <= (float)r) & (depth < cur);
+            mc_LaneMask out = ((mc_LaneMask)cur & ~take) | ((mc_LaneMask)depth & take);
+            memcpy(&row[x], &out, sizeof(out));
+        }
+    }
+}
+
+// the tile (tx, ty) of `level` and the ones under it that the pixel rectangle r overlaps, see mc_occlusion_visible
+static MC_BOOL tile_visible (const struct mc_Occlusion * occ, int level, int tx, int ty, const int r[4], float w) {
+    assert(occ != NULL);
+    size_t i = (size_t)ty * level_width(level) + tx;
+    if (w > occ->max[level][i])
+        return MC_FALSE; // behind everything in the tile
+    if ((level == 0) || (w <= occ->min[level][i]))
+        return MC_TRUE; // in front of everything in the tile, or a single pixel
+    for (int cy = 2 * ty; cy <= 2 * ty + 1; cy++)
+    for (int cx = 2 * tx; cx <= 2 * tx + 1; cx++) {
+        if ((cx < (r[0] >> (level - 1))) || (cx > (r[2] >> (level - 1))) || (cy < (r[1] >> (level - 1))) || (cy > (r[3] >> (level - 1))))
+            continue;
+        if (tile_visible(occ, level - 1, cx, cy, r, w))
+            return MC_TRUE;
+    }
+    return MC_FALSE;
+}
+
+/*============================================================================================================
+ *
+ *
+ *
+ *==========================================================================================================*/
+
+void mc_occlusion_init (struct mc_Occlusion * occ) {
+    assert(occ != NULL);
+    memset(occ, 0, sizeof(*occ));
+    for (int l = 0; l < MC_OCCLUSION_LEVELS; l++) {
+        size_t n = (size_t)level_width(l) * level_height(l);
+        occ->max[l] = malloc(sizeof(float) * n);
+        occ->min[l] = (l == 0) ? occ->max[0] : malloc(sizeof(float) * n);
+        assert((occ->max[l] != NULL) && (occ->min[l] != NULL));
+    }
+}
+
+void mc_occlusion_free (struct mc_Occlusion * occ) {
+    assert(occ != NULL);
+    for (int l = 0; l < MC_OCCLUSION_LEVELS; l++) {
+        free(occ->max[l]);
+        if (l > 0)
+            free(occ->min[l]);
+    }
+    memset(occ, 0, sizeof(*occ));
+}
+
+// clears the buffer for a new frame seen through `viewproj` from `eye`, both in the units of the boxes
+void mc_occlusion_begin (struct mc_Occlusion * occ, mat4 viewproj, const vec3 eye) {
+    assert(occ != NULL);
+    assert(viewproj != NULL);
+    glm_mat4_copy(viewproj, occ->viewproj);
+    glm_vec3_copy((float *)eye, occ->eye);
+    for (size_t i = 0; i < (size_t)MC_OCCLUSION_WIDTH * MC_OCCLUSION_HEIGHT; i++)
+        occ->max[0][i] = INFINITY;
+    occ->occluders = 0;
+    occ->quads = 0;
+    occ->built = MC_FALSE;
+}
+
+/*
+ * Rasterizes the faces of the box (min, max) that face the eye, the box has to be solid all the way through.
+ * Faces that reach behind the near plane are left out.
+ */
+void mc_occlusion_add_box (struct mc_Occlusion * occ, const vec3 min, const vec3 max) {
+    assert(occ != NULL);
+    assert(!occ->built);
+    occ->occluders++;
+
+    // corner k is at max along the axes whose bit is set in k
+    vec3 corners[8];
+    MC_BOOL projected[8];
+    for (int k = 0; k < 8; k++) {
+        vec3 p = {(k & 1) ? max[0] : min[0], (k & 2) ? max[1] : min[1], (k & 4) ? max[2] : min[2]};
+        projected[k] = project(occ, p, corners[k]);
+    }
+    for (int axis = 0; axis < 3; axis++)
+    for (int side = 0; side < 2; side++) {
+        if (side ? (occ->eye[axis] <= max[axis]) : (occ->eye[axis] >= min[axis]))
+            continue;
+        int u = 1 << ((axis + 1) % 3), v = 1 << ((axis + 2) % 3);
+        int base = side << axis;
+        int ks[4] = {base, base | u, base | u | v, base | v};
+        vec3 q[4];
+        float w = 0.0f;
+        MC_BOOL ok = MC_TRUE;
+        for (int i = 0; i < 4; i++) {
+            ok &= projected[ks[i]];
+            glm_vec3_copy(corners[ks[i]], q[i]);
+            w = MC_MAX(w, q[i][2]);
+        }
+        if (ok)
+            fill_quad(occ, (const vec3 *)q, w);
+    }
+}
+
+// the solid cells of the chunk (see mc_chunk_solid_cells) as boxes in world units, merged along Z, the whole chunk if it's solid
+void mc_occlusion_add_chunk (struct mc_Occlusion * occ, const struct mc_Chunk * chunk) {
+    assert(occ != NULL);
+    assert(chunk != NULL);
+    const float cell = MC_CHUNK_CELL * MC_BLOCK_SIZE;
+    vec3 origin = {
+        chunk->pos[0] * MC_CHUNK_SIZE * MC_BLOCK_SIZE,
+        chunk->pos[1] * MC_CHUNK_SIZE * MC_BLOCK_SIZE,
+        chunk->pos[2] * MC_CHUNK_SIZE * MC_BLOCK_SIZE
+    };
+    if (chunk->solid_cells == ~(uint64_t)0) {
+        vec3 max;
+        glm_vec3_adds(origin, MC_CHUNK_SIZE * MC_BLOCK_SIZE, max);
+        mc_occlusion_add_box(occ, origin, max);
+        return;
+    }
+    for (int cx = 0; cx < MC_CHUNK_CELLS; cx++)
+    for (int cy = 0; cy < MC_CHUNK_CELLS; cy++) {
+        uint64_t column = (chunk->solid_cells >> ((cx * MC_CHUNK_CELLS + cy) * MC_CHUNK_CELLS)) & ((1u << MC_CHUNK_CELLS) - 1);
+        while (column != 0) {
+            int z0 = __builtin_ctzll(column);
+            int z1 = z0 + __builtin_ctzll(~(column >> z0));
+            column &= ~(uint64_t)0 << z1;
+            vec3 min = {origin[0] + cx * cell, origin[1] + cy * cell, origin[2] + z0 * cell};
+            vec3 max = {min[0] + cell, min[1] + cell, origin[2] + z1 * cell};
+            mc_occlusion_add_box(occ, min, max);
+        }
+    }
+}
+
+// builds the pyramid, call once all the occluders have been added and before testing boxes
+void mc_occlusion_finish (struct mc_Occlusion * occ) {
+    assert(occ != NULL);
+    for (int l = 1; l < MC_OCCLUSION_LEVELS; l++) {
+        int w = level_width(l), h = level_height(l), pw = level_width(l - 1);
+        const float * pmax = occ->max[l - 1], * pmin = occ->min[l - 1];
+        for (int y = 0; y < h; y++)
+        for (int x = 0; x < w; x++) {
+            size_t a = (size_t)(2 * y) * pw + 2 * x, b = a + pw;
+            occ->max[l][y * w + x] = MC_MAX(MC_MAX(pmax[a], pmax[a + 1]), MC_MAX(pmax[b], pmax[b + 1]));
+            occ->min[l][y * w + x] = MC_MIN(MC_MIN(pmin[a], pmin[a + 1]), MC_MIN(pmin[b], pmin[b + 1]));
+        }
+    }
+    occ->built = MC_TRUE;
+}
+
+// MC_FALSE if the box (min, max) is hidden behind the occluders, boxes reaching behind the near plane always count as visible
+MC_BOOL mc_occlusion_visible (const struct mc_Occlusion * occ, const vec3 min, const vec3 max) {
+    assert(occ != NULL);
+    assert(occ->built);
+    float x0 = INFINITY, y0 = INFINITY, x1 = -INFINITY, y1 = -INFINITY, w = INFINITY;
+    for (int k = 0; k < 8; k++) {
+        vec3 p = {(k & 1) ? max[0] : min[0], (k & 2) ? max[1] : min[1], (k & 4) ? max[2] : min[2]}, s;
+        if (!project(occ, p, s))
+            return MC_TRUE;
+        x0 = MC_MIN(x0, s[0]); x1 = MC_MAX(x1, s[0]);
+        y0 = MC_MIN(y0, s[1]); y1 = MC_MAX(y1, s[1]);
+        w = MC_MIN(w, s[2]);
+    }
+    // every pixel the box touches
+    int r[4] = {
+        MC_MAX(0, (int)floorf(x0)), MC_MAX(0, (int)floorf(y0)),
+        MC_MIN(MC_OCCLUSION_WIDTH - 1, (int)floorf(x1)), MC_MIN(MC_OCCLUSION_HEIGHT - 1, (int)floorf(y1))
+    };
+    if ((r[0] > r[2]) || (r[1] > r[3]))
+        return MC_TRUE; // off screen, that's for the frustum to decide
+
+    // the coarsest level the rectangle covers at most 2x2 tiles of, refined only where that doesn't settle it
+    int level = 0;
+    while ((level < MC_OCCLUSION_LEVELS - 1) && (((r[2] >> level) - (r[0] >> level) > 1) || ((r[3] >> level) - (r[1] >> level) > 1)))
+        level++;
+    for (int ty = r[1] >> level; ty <= r[3] >> level; ty++)
+    for (int tx = r[0] >> level; tx <= r[2] >> level; tx++)
+        if (tile_visible(occ, level, tx, ty, r, w))
+            return MC_TRUE;
+    return MC_FALSE;
+}
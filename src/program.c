@@ -95,4 +95,10 @@ inline void mc_program_set_int (GLuint ID, const char *name, int x) {
     assert(ID != 0);
     assert(name != NULL);
 	glUniform1i(glGetUniformLocation(ID, name), x);
+}
+
+inline void mc_program_set_float (GLuint ID, const char *name, GLfloat x) {
+    assert(ID != 0);
+    assert(name != NULL);
+	glUniform1f(glGetUniformLocation(ID, name), x);
 }
\ No newline at end of file
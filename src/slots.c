@@ -0,0 +1,221 @@
+/*
+ *
+ * Slots
+ * Hands out contiguous runs of fixed-size slots from a buffer kept elsewhere (the world VBO),
+ * always the lowest run that fits, so the part in use stays packed at the start of it.
+ * Each 64-slot word of the bitmap is summarized by a bit in `full` and one in `any`,
+ * searches go through the summaries and only look at the words a run can start or end in.
+ * The holes (free runs that end below the top) are indexed by a max tree over the words, whose leaves
+ * are the longest hole starting in each word, mc_slots_find walks down it to the lowest one that fits.
+ *
+ */
+
+#include "mc.h"
+
+static inline uint64_t mask_bits (uint32_t shift, uint32_t n) {
+    return ((n == 64) ? ~(uint64_t)0 : (((uint64_t)1 << n) - 1)) << shift;
+}
+
+static void reserve (struct mc_Slots * slots, size_t words) {
+    assert(slots != NULL);
+    if (words <= slots->words)
+        return;
+    size_t cap = MC_MAX(words, slots->words * 2);
+    cap = (cap + 63) & ~(size_t)63; // whole summary words
+    size_t sum = slots->words / 64, sum_cap = cap / 64;
+    slots->bits = realloc(slots->bits, sizeof(*slots->bits) * cap);
+    slots->full = realloc(slots->full, sizeof(*slots->full) * sum_cap);
+    slots->any  = realloc(slots->any,  sizeof(*slots->any)  * sum_cap);
+    assert((slots->bits != NULL) && (slots->full != NULL) && (slots->any != NULL));
+    memset(&slots->bits[slots->words], 0, sizeof(*slots->bits) * (cap - slots->words));
+    memset(&slots->full[sum], 0, sizeof(*slots->full) * (sum_cap - sum));
+    memset(&slots->any[sum],  0, sizeof(*slots->any)  * (sum_cap - sum));
+    slots->words = cap;
+
+    size_t leaves = MC_MAX(slots->leaves, 1);
+    while (leaves < cap)
+        leaves *= 2;
+    if (leaves == slots->leaves)
+        return;
+    uint32_t * longest = calloc(2 * leaves, sizeof(*longest));
+    assert(longest != NULL);
+    if (slots->leaves > 0)
+        memcpy(&longest[leaves], &slots->longest[slots->leaves], sizeof(*longest) * slots->leaves);
+    for (size_t i = leaves - 1; i > 0; i--)
+        longest[i] = MC_MAX(longest[2 * i], longest[2 * i + 1]);
+    free(slots->longest);
+    slots->longest = longest;
+    slots->leaves = leaves;
+}
+
+static void set (struct mc_Slots * slots, uint32_t first, uint32_t count, MC_BOOL used) {
+    assert(slots != NULL);
+    reserve(slots, ((size_t)first + count + 63) / 64);
+    for (uint32_t i = first; i < first + count;) {
+        uint32_t n = MC_MIN(64 - i % 64, first + count - i);
+        size_t w = i / 64;
+        if (used)
+            slots->bits[w] |= mask_bits(i % 64, n);
+        else
+            slots->bits[w] &= ~mask_bits(i % 64, n);
+        uint64_t bit = (uint64_t)1 << (w % 64);
+        slots->full[w / 64] = (slots->bits[w] == ~(uint64_t)0) ? (slots->full[w / 64] | bit) : (slots->full[w / 64] & ~bit);
+        slots->any[w / 64]  = (slots->bits[w] != 0)            ? (slots->any[w / 64]  | bit) : (slots->any[w / 64]  & ~bit);
+        i += n;
+    }
+}
+
+// the first word at or after `w` that has a slot whose bit is `used`, slots->words if there's none
+static size_t next_word (const struct mc_Slots * slots, size_t w, MC_BOOL used) {
+    assert(slots != NULL);
+    if (w >= slots->words)
+        return slots->words;
+    size_t s = w / 64;
+    uint64_t sum = (used ? slots->any[s] : ~slots->full[s]) & (~(uint64_t)0 << (w % 64));
+    while (sum == 0) {
+        if (++s * 64 >= slots->words)
+            return slots->words;
+        sum = used ? slots->any[s] : ~slots->full[s];
+    }
+    return s * 64 + __builtin_ctzll(sum);
+}
+
+// one past the last word before `w` that has a slot in use, 0 if there's none
+static size_t prev_word (const struct mc_Slots * slots, size_t w) {
+    assert(slots != NULL);
+    while (w > 0) {
+        size_t s = (w - 1) / 64;
+        uint64_t sum = slots->any[s] & mask_bits(0, (w - 1) % 64 + 1);
+        if (sum != 0)
+            return s * 64 + 64 - __builtin_clzll(sum);
+        w = s * 64;
+    }
+    return 0;
+}
+
+// the first slot of the free run that ends right before `slot`, `slot` itself if the one before it is in use
+static uint32_t run_start (const struct mc_Slots * slots, uint32_t slot) {
+    assert(slots != NULL);
+    size_t w = slot / 64;
+    uint64_t used = slots->bits[w] & mask_bits(0, slot % 64);
+    if (used == 0) {
+        w = prev_word(slots, w);
+        if (w == 0)
+            return 0;
+        used = slots->bits[--w];
+    }
+    return (uint32_t)(w * 64 + 64 - __builtin_clzll(used));
+}
+
+// the free slots of word w that come right after one in use (or the start of the buffer)
+static inline uint64_t run_starts (const struct mc_Slots * slots, size_t w) {
+    uint64_t used = slots->bits[w];
+    return ~used & ((used << 1) | ((w > 0) ? (slots->bits[w - 1] >> 63) : 1));
+}
+
+// the first hole of `count` slots at least that starts in word w, slots->top if there's none
+static uint32_t word_hole (const struct mc_Slots * slots, size_t w, uint32_t count) {
+    assert(slots != NULL);
+    for (uint64_t starts = run_starts(slots, w); starts != 0; starts &= starts - 1) {
+        uint32_t first = (uint32_t)(w * 64 + __builtin_ctzll(starts));
+        if (first >= slots->top)
+            break;
+        uint32_t end = mc_slots_next(slots, first, MC_TRUE);
+        if ((end < slots->top) && (end - first >= count))
+            return first;
+    }
+    return slots->top;
+}
+
+// recomputes the leaves of the words from `first` to `last` (slots) and the nodes above them
+static void index_holes (struct mc_Slots * slots, uint32_t first, uint32_t last) {
+    assert(slots != NULL);
+    size_t lo = first / 64, hi = MC_MIN(last / 64, slots->words - 1);
+    for (size_t w = lo; w <= hi; w++) {
+        uint32_t longest = 0;
+        for (uint64_t starts = run_starts(slots, w); starts != 0; starts &= starts - 1) {
+            uint32_t start = (uint32_t)(w * 64 + __builtin_ctzll(starts));
+            if (start >= slots->top)
+                break;
+            longest = MC_MAX(longest, mc_slots_next(slots, start, MC_TRUE) - start);
+        }
+        slots->longest[slots->leaves + w] = longest;
+    }
+    for (lo = (slots->leaves + lo) / 2, hi = (slots->leaves + hi) / 2; lo > 0; lo /= 2, hi /= 2)
+        for (size_t i = lo; i <= hi; i++)
+            slots->longest[i] = MC_MAX(slots->longest[2 * i], slots->longest[2 * i + 1]);
+}
+
+/*============================================================================================================
+ *
+ *
+ *
+ *==========================================================================================================*/
+
+void mc_slots_init (struct mc_Slots * slots) {
+    assert(slots != NULL);
+    memset(slots, 0, sizeof(*slots));
+}
+
+void mc_slots_free (struct mc_Slots * slots) {
+    assert(slots != NULL);
+    free(slots->bits);
+    free(slots->full);
+    free(slots->any);
+    free(slots->longest);
+    memset(slots, 0, sizeof(*slots));
+}
+
+// the first slot at or after `slot` whose bit is `used`, slots->top if there's none below it
+uint32_t mc_slots_next (const struct mc_Slots * slots, uint32_t slot, MC_BOOL used) {
+    assert(slots != NULL);
+    uint32_t top = slots->top;
+    if (slot >= top)
+        return top;
+    size_t w = slot / 64;
+    uint64_t bits = (used ? slots->bits[w] : ~slots->bits[w]) & (~(uint64_t)0 << (slot % 64));
+    if (bits == 0) {
+        w = next_word(slots, w + 1, used);
+        if (w * 64 >= top)
+            return top;
+        bits = used ? slots->bits[w] : ~slots->bits[w];
+    }
+    return MC_MIN(top, (uint32_t)(w * 64 + __builtin_ctzll(bits)));
+}
+
+// the lowest run of `count` free slots, slots->top if no hole below it is big enough
+uint32_t mc_slots_find (const struct mc_Slots * slots, uint32_t count) {
+    assert(slots != NULL);
+    assert(count > 0);
+    if ((slots->leaves == 0) || (slots->longest[1] < count))
+        return slots->top;
+    size_t i = 1;
+    while (i < slots->leaves)
+        i = 2 * i + (slots->longest[2 * i] < count);
+    return word_hole(slots, i - slots->leaves, count);
+}
+
+// marks `count` slots from `first` as used, they must be free (see mc_slots_find)
+void mc_slots_take (struct mc_Slots * slots, uint32_t first, uint32_t count) {
+    assert(slots != NULL);
+    assert(mc_slots_next(slots, first, MC_TRUE) >= MC_MIN(first + count, slots->top));
+    if (count == 0)
+        return;
+    set(slots, first, count, MC_TRUE);
+    slots->top = MC_MAX(slots->top, first + count);
+    index_holes(slots, run_start(slots, first), first + count);
+}
+
+void mc_slots_release (struct mc_Slots * slots, uint32_t first, uint32_t count) {
+    assert(slots != NULL);
+    assert(first + count <= slots->top);
+    if (count == 0)
+        return;
+    set(slots, first, count, MC_FALSE);
+    if (first + count >= slots->top) {
+        // the top comes down to the end of the highest range still in use
+        size_t w = prev_word(slots, (first + 63) / 64);
+        slots->top = (w == 0) ? 0 : (uint32_t)(w * 64 - __builtin_clzll(slots->bits[w - 1]));
+    }
+    index_holes(slots, run_start(slots, first), first + count);
+}
@@ -0,0 +1,348 @@
+/*
+ *
+ * Chunk streaming
+ * Worker threads generate the requested chunks and mesh them, or mesh again copies of loaded chunks that changed,
+ * against the borders of the neighbours copied when the job was queued. The main thread picks the finished jobs up
+ * (mc_stream_pop) and only has to upload their meshes (see mc_world_update).
+ * The queued and the finished jobs are both binary heaps on their priority, the chunk of every requested job
+ * is created right away and kept in st->pending until it's popped or cancelled.
+ *
+ */
+
+#include "mc.h"
+
+#include <stdlib.h>
+
+#define MC_STREAM_INITIAL_CAP (64)
+
+static void push (struct mc_StreamJob ** jobs, size_t * count, size_t * cap, const struct mc_StreamJob * job) {
+    assert(jobs != NULL);
+    assert(count != NULL);
+    assert(cap != NULL);
+    if (*count == *cap) {
+        *cap = (*cap == 0) ? MC_STREAM_INITIAL_CAP : *cap * 2;
+        *jobs = realloc(*jobs, sizeof(**jobs) * *cap);
+        assert(*jobs != NULL);
+    }
+    (*jobs)[(*count)++] = *job;
+}
+
+// lower goes first, chunks behind the camera count as up to 3 times as far away
+static float priority (const struct mc_Stream * st, const ivec3 pos) {
+    vec3 d;
+    for (int i = 0; i < 3; i++)
+        d[i] = (pos[i] + 0.5f) * MC_CHUNK_SIZE - st->eye[i];
+    float dist = glm_vec3_norm(d);
+    if (dist == 0.0f)
+        return 0.0f;
+    float facing = glm_vec3_dot(d, (float *)st->front) / dist;
+    return dist * (2.0f - facing);
+}
+
+/*============================================================================================================
+ *
+ * Heaps
+ * jobs[0] has the lowest priority value, the children of i are 2i + 1 and 2i + 2
+ *
+ *==========================================================================================================*/
+
+static void sift_up (struct mc_StreamJob * jobs, size_t i) {
+    assert(jobs != NULL);
+    struct mc_StreamJob job = jobs[i];
+    while (i > 0) {
+        size_t parent = (i - 1) / 2;
+        if (jobs[parent].priority <= job.priority)
+            break;
+        jobs[i] = jobs[parent];
+        i = parent;
+    }
+    jobs[i] = job;
+}
+
+static void sift_down (struct mc_StreamJob * jobs, size_t count, size_t i) {
+    assert(jobs != NULL);
+    struct mc_StreamJob job = jobs[i];
+    for (;;) {
+        size_t child = 2 * i + 1;
+        if (child >= count)
+            break;
+        if ((child + 1 < count) && (jobs[child + 1].priority < jobs[child].priority))
+            child++;
+        if (job.priority <= jobs[child].priority)
+            break;
+        jobs[i] = jobs[child];
+        i = child;
+    }
+    jobs[i] = job;
+}
+
+static void heap_push (struct mc_StreamJob ** jobs, size_t * count, size_t * cap, const struct mc_StreamJob * job) {
+    push(jobs, count, cap, job);
+    sift_up(*jobs, *count - 1);
+}
+
+static struct mc_StreamJob heap_pop (struct mc_StreamJob * jobs, size_t * count) {
+    assert(jobs != NULL);
+    assert(*count > 0);
+    struct mc_StreamJob top = jobs[0];
+    jobs[0] = jobs[--*count];
+    if (*count > 0)
+        sift_down(jobs, *count, 0);
+    return top;
+}
+
+// after the priorities changed or jobs were removed from the middle
+static void heapify (struct mc_StreamJob * jobs, size_t count) {
+    for (size_t i = count / 2; i-- > 0;)
+        sift_down(jobs, count, i);
+}
+
+static void reprioritize (const struct mc_Stream * st, struct mc_StreamJob * jobs, size_t count) {
+    assert(st != NULL);
+    for (size_t i = 0; i < count; i++)
+        jobs[i].priority = priority(st, jobs[i].pos);
+    heapify(jobs, count);
+}
+
+/*============================================================================================================
+ *
+ * Workers
+ *
+ *==========================================================================================================*/
+
+// moves the queued job with the highest priority to `busy`
+static struct mc_StreamJob take_next (struct mc_Stream * st) {
+    assert(st != NULL);
+    struct mc_StreamJob job = heap_pop(st->queued, &st->queued_count);
+    push(&st->busy, &st->busy_count, &st->busy_cap, &job);
+    return job;
+}
+
+static void finish (struct mc_Stream * st, struct mc_StreamJob * job) {
+    assert(st != NULL);
+    assert(job != NULL);
+    for (size_t i = 0; i < st->busy_count; i++) {
+        if (st->busy[i].chunk != job->chunk)
+            continue;
+        st->busy[i] = st->busy[--st->busy_count];
+        break;
+    }
+    job->priority = priority(st, job->pos);
+    heap_push(&st->done, &st->done_count, &st->done_cap, job);
+}
+
+static void * worker (void * arg) {
+    struct mc_Stream * st = arg;
+    struct mc_Mesh mesh; // only its scratch memory outlives a job
+    mc_mesh_init(&mesh);
+    pthread_mutex_lock(&st->lock);
+    for (;;) {
+        while (!st->quit && (st->queued_count == 0))
+            pthread_cond_wait(&st->wake, &st->lock);
+        if (st->quit)
+            break;
+        struct mc_StreamJob job = take_next(st);
+        pthread_mutex_unlock(&st->lock);
+        mc_stream_build(st->fnl, &job, &mesh);
+        pthread_mutex_lock(&st->lock);
+        finish(st, &job);
+    }
+    pthread_mutex_unlock(&st->lock);
+    mc_mesh_free(&mesh);
+    return NULL;
+}
+
+/*============================================================================================================
+ *
+ *
+ *
+ *==========================================================================================================*/
+
+void mc_stream_init (struct mc_Stream * st, fnl_state * fnl) {
+    assert(st != NULL);
+    assert(fnl != NULL);
+    memset(st, 0, sizeof(*st));
+    st->fnl = fnl;
+    st->front[2] = -1.0f;
+    mc_chunkmap_init(&st->pending);
+    pthread_mutex_init(&st->lock, NULL);
+    pthread_cond_init(&st->wake, NULL);
+    for (int i = 0; i < MC_STREAM_THREADS; i++) {
+        int err = pthread_create(&st->threads[i], NULL, worker, st);
+        assert(err == 0);
+        (void)err;
+    }
+}
+
+void mc_stream_free (struct mc_Stream * st) {
+    assert(st != NULL);
+    pthread_mutex_lock(&st->lock);
+    st->quit = MC_TRUE;
+    pthread_cond_broadcast(&st->wake);
+    pthread_mutex_unlock(&st->lock);
+    for (int i = 0; i < MC_STREAM_THREADS; i++)
+        pthread_join(st->threads[i], NULL);
+
+    for (size_t i = 0; i < st->done_count; i++)
+        mc_stream_release(&st->done[i]);
+    for (size_t i = 0; i < st->queued_count; i++)
+        mc_stream_release(&st->queued[i]);
+    free(st->queued);
+    free(st->busy);
+    free(st->done);
+    mc_chunkmap_free(&st->pending);
+    pthread_cond_destroy(&st->wake);
+    pthread_mutex_destroy(&st->lock);
+}
+
+// the blocks of a new chunk
+static void generate (fnl_state * fnl, struct mc_Chunk * chunk) {
+    assert(fnl != NULL);
+    assert(chunk != NULL);
+    int ox = chunk->pos[0] * MC_CHUNK_SIZE;
+    int oy = chunk->pos[1] * MC_CHUNK_SIZE;
+    int oz = chunk->pos[2] * MC_CHUNK_SIZE;
+    mc_BlockID * ids = malloc(sizeof(*ids) * MC_CHUNK_BLOCKS);
+    assert(ids != NULL);
+    for (int lx = 0; lx < MC_CHUNK_SIZE; lx++)
+    for (int ly = 0; ly < MC_CHUNK_SIZE; ly++)
+    for (int lz = 0; lz < MC_CHUNK_SIZE; lz++) {
+        float noise = fnlGetNoise3D(fnl, ox + lx, oy + ly, oz + lz);
+        ids[mc_chunk_idx(lx, ly, lz)] = (noise > 0.0f) ? MC_BLOCK_TYPE_GRASS : MC_BLOCK_TYPE_NONE;
+    }
+    mc_chunk_fill(chunk, ids);
+    free(ids);
+}
+
+/*
+ * Runs a job on the calling thread: generates the chunk at job->pos into job->chunk (created if it's NULL)
+ * for MC_STREAM_JOB_GENERATE, then meshes it into job->mesh, `mesh` lends its scratch memory.
+ */
+void mc_stream_build (fnl_state * fnl, struct mc_StreamJob * job, struct mc_Mesh * mesh) {
+    assert(fnl != NULL);
+    assert(job != NULL);
+    assert(job->borders != NULL);
+    assert(mesh != NULL);
+
+    if (job->kind == MC_STREAM_JOB_GENERATE) {
+        if (job->chunk == NULL)
+            job->chunk = mc_chunk_create(job->pos[0], job->pos[1], job->pos[2]);
+        generate(fnl, job->chunk);
+    }
+    mc_mesh_build(mesh, job->chunk, job->borders, job->greedy);
+    mc_mesh_move(&job->mesh, mesh);
+    job->solid_cells = mc_chunk_solid_cells(job->chunk);
+    mc_chunk_face_links(job->chunk, job->links);
+}
+
+// frees what a job owns, except the chunk of a popped MC_STREAM_JOB_GENERATE job if the caller cleared job->chunk
+void mc_stream_release (struct mc_StreamJob * job) {
+    assert(job != NULL);
+    if (job->chunk != NULL)
+        mc_chunk_destroy(job->chunk);
+    free(job->borders);
+    mc_mesh_free(&job->mesh);
+    job->chunk = NULL;
+    job->borders = NULL;
+}
+
+static void queue (struct mc_Stream * st, struct mc_StreamJob * job) {
+    assert(st != NULL);
+    assert(job != NULL);
+    mc_mesh_init(&job->mesh);
+    job->priority = priority(st, job->pos);
+    heap_push(&st->queued, &st->queued_count, &st->queued_cap, job);
+    pthread_cond_signal(&st->wake);
+}
+
+/*
+ * Generates and meshes the chunk, the stream owns `borders` (malloc'ed) from here on.
+ * Does nothing if the chunk is already queued, being built or waiting to be popped.
+ */
+void mc_stream_request (struct mc_Stream * st, int cx, int cy, int cz, struct mc_ChunkBorders * borders, MC_BOOL greedy) {
+    assert(st != NULL);
+    assert(borders != NULL);
+    pthread_mutex_lock(&st->lock);
+    if (mc_chunkmap_get(&st->pending, cx, cy, cz) == NULL) {
+        struct mc_StreamJob job = {
+            .kind = MC_STREAM_JOB_GENERATE, .pos = {cx, cy, cz}, .chunk = mc_chunk_create(cx, cy, cz),
+            .borders = borders, .greedy = greedy
+        };
+        mc_chunkmap_insert(&st->pending, job.chunk);
+        queue(st, &job);
+    }
+    else
+        free(borders);
+    pthread_mutex_unlock(&st->lock);
+}
+
+// meshes `chunk` (a copy the stream takes over, see mc_chunk_clone) against `borders` (malloc'ed, taken over too)
+void mc_stream_mesh (struct mc_Stream * st, struct mc_Chunk * chunk, struct mc_ChunkBorders * borders, MC_BOOL greedy, uint32_t version) {
+    assert(st != NULL);
+    assert(chunk != NULL);
+    assert(borders != NULL);
+    struct mc_StreamJob job = {
+        .kind = MC_STREAM_JOB_MESH, .pos = {chunk->pos[0], chunk->pos[1], chunk->pos[2]}, .chunk = chunk,
+        .borders = borders, .greedy = greedy, .version = version
+    };
+    pthread_mutex_lock(&st->lock);
+    queue(st, &job);
+    pthread_mutex_unlock(&st->lock);
+}
+
+// drops the queued chunks outside of the box, chunks that are already being built still get popped
+void mc_stream_cancel (struct mc_Stream * st, const int origin[3], const int size[3]) {
+    assert(st != NULL);
+    pthread_mutex_lock(&st->lock);
+    for (size_t i = 0; i < st->queued_count;) {
+        const int * pos = st->queued[i].pos;
+        MC_BOOL inside = MC_TRUE;
+        for (int a = 0; a < 3; a++)
+            inside = inside && (pos[a] >= origin[a]) && (pos[a] < origin[a] + size[a]);
+        if (inside) {
+            i++;
+            continue;
+        }
+        if (st->queued[i].kind == MC_STREAM_JOB_GENERATE)
+            mc_chunkmap_remove(&st->pending, st->queued[i].chunk);
+        mc_stream_release(&st->queued[i]);
+        st->queued[i] = st->queued[--st->queued_count];
+    }
+    heapify(st->queued, st->queued_count);
+    pthread_mutex_unlock(&st->lock);
+}
+
+// eye in blocks, `front` normalized, the waiting jobs are ordered again
+void mc_stream_set_view (struct mc_Stream * st, vec3 eye, vec3 front) {
+    assert(st != NULL);
+    pthread_mutex_lock(&st->lock);
+    glm_vec3_copy(eye, st->eye);
+    glm_vec3_copy(front, st->front);
+    reprioritize(st, st->queued, st->queued_count);
+    reprioritize(st, st->done, st->done_count);
+    pthread_mutex_unlock(&st->lock);
+}
+
+// takes the finished job with the highest priority, the caller owns it (see mc_stream_release)
+MC_BOOL mc_stream_pop (struct mc_Stream * st, struct mc_StreamJob * job) {
+    assert(st != NULL);
+    assert(job != NULL);
+    pthread_mutex_lock(&st->lock);
+    MC_BOOL popped = (st->done_count > 0);
+    if (popped) {
+        *job = heap_pop(st->done, &st->done_count);
+        if (job->kind == MC_STREAM_JOB_GENERATE)
+            mc_chunkmap_remove(&st->pending, job->chunk);
+    }
+    pthread_mutex_unlock(&st->lock);
+    return popped;
+}
+
+// jobs queued but not popped yet
+size_t mc_stream_pending (struct mc_Stream * st) {
+    assert(st != NULL);
+    pthread_mutex_lock(&st->lock);
+    size_t pending = st->queued_count + st->busy_count + st->done_count;
+    pthread_mutex_unlock(&st->lock);
+    return pending;
+}
@@ -11,8 +11,10 @@
 
 #include "mc.h"
 
-void mc_textr_create (struct mc_TextRenderer *textr) {
+void mc_textr_create (struct mc_TextRenderer *textr, struct mc_UploadRing * upload) {
     assert(textr != NULL);
+    assert(upload != NULL);
+    textr->upload = upload;
 
     // program
     textr->prog = mc_program_create("TEXT", "C:/Users/Win10/Desktop/projects/mc/res/shaders/text.vert", "C:/Users/Win10/Desktop/projects/mc/res/shaders/text.frag");
@@ -26,11 +28,10 @@ void mc_textr_create (struct mc_TextRenderer *textr) {
     // font
     mc_tex_create(&textr->font, "res/img/font.png");
 
+    // the attributes point at the start of the ring, every line is drawn from where it was written to
     glGenVertexArrays(1, &textr->VAO);
-    glGenBuffers(1, &textr->VBO);
     glBindVertexArray(textr->VAO);
-    glBindBuffer(GL_ARRAY_BUFFER, textr->VBO);
-	glBufferData(GL_ARRAY_BUFFER, MC_TEXT_MAX_CHARS * MC_TEXT_VERTICES * sizeof(struct mc_TextVertex), NULL, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, upload->buffer);
 	glEnableVertexAttribArray(0);
 	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(struct mc_TextVertex), offsetof(struct mc_TextVertex, x));
     glEnableVertexAttribArray(1);
@@ -40,7 +41,6 @@ void mc_textr_create (struct mc_TextRenderer *textr) {
 void mc_textr_destroy (struct mc_TextRenderer *textr) {
     assert(textr != NULL);
     glDeleteVertexArrays(1, &textr->VAO);
-	glDeleteBuffers(1, &textr->VBO);
 }
 
 void mc_textr_draw (struct mc_TextRenderer *textr, float x, float y, const char * src) {
@@ -51,9 +51,14 @@ void mc_textr_draw (struct mc_TextRenderer *textr, float x, float y, const char
 
     int len = strlen(src);
     assert(len <= MC_TEXT_MAX_CHARS);
+    if (len == 0)
+        return;
 
-    static GLfloat vertices[MC_TEXT_MAX_CHARS * MC_TEXT_VERTICES * MC_TEXT_VERTEX_ELEMENTS];
-    GLfloat * v = &vertices;
+    GLsizeiptr size = len * MC_TEXT_VERTICES * sizeof(struct mc_TextVertex);
+    GLintptr offset;
+    GLfloat * v = mc_upload_map_wait(textr->upload, size, &offset);
+    if (v == NULL)
+        return;
 
     float x2 = x + MC_TEXT_CHAR_WIDTH;
     float y2 = y - MC_TEXT_CHAR_HEIGHT;
@@ -77,15 +82,11 @@ void mc_textr_draw (struct mc_TextRenderer *textr, float x, float y, const char
         v += MC_TEXT_VERTICES * MC_TEXT_VERTEX_ELEMENTS;
     }
 
-    glBindBuffer(GL_ARRAY_BUFFER, textr->VBO);
-	glBufferSubData(GL_ARRAY_BUFFER, 0,
-        len * MC_TEXT_VERTICES * sizeof(struct mc_TextVertex),
-        vertices
-    );
+    mc_upload_unmap(textr->upload);
 
     glUseProgram(textr->prog);
     glActiveTexture(GL_TEXTURE0);
     glBindTexture(GL_TEXTURE_2D, textr->font.id);
     glBindVertexArray(textr->VAO);
-	glDrawArrays(GL_TRIANGLES, 0, len * MC_TEXT_VERTICES);
+	glDrawArrays(GL_TRIANGLES, offset / sizeof(struct mc_TextVertex), len * MC_TEXT_VERTICES);
 }
\ No newline at end of file
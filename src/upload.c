@@ -0,0 +1,154 @@
+/*
+ *
+ * Upload ring
+ * A single streaming buffer the CPU writes into through unsynchronized mappings, so mapping never waits for the GPU.
+ * What a frame wrote is only reused once the fence placed after it (mc_upload_frame) has signaled.
+ * The data is either copied on the GPU into its final buffer (mc_upload_copy) or drawn from the ring as it is.
+ *
+ */
+
+#include "mc.h"
+
+static inline size_t align_up (size_t n) {
+    return (n + MC_UPLOAD_ALIGN - 1) & ~(size_t)(MC_UPLOAD_ALIGN - 1);
+}
+
+// gives the room of the frames the GPU is done with back, without waiting
+static void retire (struct mc_UploadRing * ring) {
+    assert(ring != NULL);
+    size_t done = 0;
+    while (done < ring->fences_count) {
+        GLenum status = glClientWaitSync(ring->fences[done].sync, 0, 0);
+        if ((status != GL_ALREADY_SIGNALED) && (status != GL_CONDITION_SATISFIED))
+            break;
+        glDeleteSync(ring->fences[done].sync);
+        ring->used -= ring->fences[done].bytes;
+        done++;
+    }
+    ring->fences_count -= done;
+    memmove(&ring->fences[0], &ring->fences[done], sizeof(*ring->fences) * ring->fences_count);
+}
+
+/*============================================================================================================
+ *
+ *
+ *
+ *==========================================================================================================*/
+
+void mc_upload_init (struct mc_UploadRing * ring, size_t size) {
+    assert(ring != NULL);
+    assert(size > 0);
+    memset(ring, 0, sizeof(*ring));
+    ring->size = align_up(size);
+    glGenBuffers(1, &ring->buffer);
+    glBindBuffer(GL_COPY_READ_BUFFER, ring->buffer);
+    glBufferData(GL_COPY_READ_BUFFER, ring->size, NULL, GL_STREAM_DRAW);
+}
+
+void mc_upload_free (struct mc_UploadRing * ring) {
+    assert(ring != NULL);
+    for (size_t i = 0; i < ring->fences_count; i++)
+        glDeleteSync(ring->fences[i].sync);
+    glDeleteBuffers(1, &ring->buffer);
+    memset(ring, 0, sizeof(*ring));
+}
+
+/*
+ * Maps `size` bytes of the ring for writing, their offset in ring->buffer goes to `offset`.
+ * Returns NULL if the GPU still reads all the room there is, the caller can try again next frame
+ * or mc_upload_stall. Every successful call must be followed by mc_upload_unmap before the data is used.
+ */
+void * mc_upload_map (struct mc_UploadRing * ring, size_t size, GLintptr * offset) {
+    assert(ring != NULL);
+    assert(offset != NULL);
+    assert(size > 0);
+    size = align_up(size);
+    retire(ring);
+    if (ring->used == 0)
+        ring->head = 0;
+
+    // an allocation never wraps around, the rest of the ring is skipped instead
+    size_t waste = (ring->head + size > ring->size) ? ring->size - ring->head : 0;
+    if (ring->used + waste + size > ring->size)
+        return NULL;
+    if (waste > 0)
+        ring->head = 0;
+    *offset = (GLintptr)ring->head;
+    ring->head += size;
+    ring->used += waste + size;
+    ring->frame_bytes += waste + size;
+    ring->frame_uploads++;
+
+    glBindBuffer(GL_COPY_READ_BUFFER, ring->buffer);
+    void * p = glMapBufferRange(GL_COPY_READ_BUFFER, *offset, size, GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+    assert(p != NULL);
+    return p;
+}
+
+void mc_upload_unmap (struct mc_UploadRing * ring) {
+    assert(ring != NULL);
+    glBindBuffer(GL_COPY_READ_BUFFER, ring->buffer);
+    GLboolean ok = glUnmapBuffer(GL_COPY_READ_BUFFER);
+    assert(ok == GL_TRUE);
+    (void)ok;
+}
+
+/*
+ * Like mc_upload_map but waits for the GPU instead of failing.
+ * Returns NULL only if `size` can't fit even once every frame before this one is done with the ring.
+ */
+void * mc_upload_map_wait (struct mc_UploadRing * ring, size_t size, GLintptr * offset) {
+    assert(ring != NULL);
+    if (align_up(size) > ring->size - ring->frame_bytes) {
+        MC_PERR("upload of %zu bytes doesn't fit into the ring (%zu bytes, %zu taken this frame)\n", size, ring->size, ring->frame_bytes);
+        return NULL;
+    }
+    void * p;
+    while ((p = mc_upload_map(ring, size, offset)) == NULL) {
+        // nothing left to wait for, what's in the way (the end of the ring it would skip) is this frame's own
+        if (ring->fences_count == 0) {
+            MC_PERR("upload of %zu bytes doesn't fit into the rest of the ring this frame\n", size);
+            return NULL;
+        }
+        mc_upload_stall(ring);
+    }
+    return p;
+}
+
+// copies `size` bytes written at `offset` (see mc_upload_map) to `dst` at `dst_offset`, on the GPU
+void mc_upload_copy (struct mc_UploadRing * ring, GLintptr offset, GLuint dst, GLintptr dst_offset, size_t size) {
+    assert(ring != NULL);
+    assert(offset + size <= ring->size);
+    glBindBuffer(GL_COPY_READ_BUFFER, ring->buffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, dst);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, offset, dst_offset, size);
+}
+
+// blocks until the GPU is done with the oldest frame in flight, for uploads a frame can't do without
+void mc_upload_stall (struct mc_UploadRing * ring) {
+    assert(ring != NULL);
+    if (ring->fences_count == 0)
+        return;
+    ring->stalls++;
+    while (glClientWaitSync(ring->fences[0].sync, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED)
+        ;
+    retire(ring);
+}
+
+// call once the commands reading what the frame uploaded have been issued
+void mc_upload_frame (struct mc_UploadRing * ring) {
+    assert(ring != NULL);
+    ring->last_frame_bytes = ring->frame_bytes;
+    ring->last_frame_uploads = ring->frame_uploads;
+    ring->frame_uploads = 0;
+    if (ring->frame_bytes == 0)
+        return;
+    retire(ring);
+    if (ring->fences_count == MC_UPLOAD_FENCES)
+        mc_upload_stall(ring);
+    ring->fences[ring->fences_count++] = (struct mc_UploadFence){
+        .sync  = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0),
+        .bytes = ring->frame_bytes
+    };
+    ring->frame_bytes = 0;
+}
@@ -1,151 +1,740 @@
 #include "mc.h"
 
+#include <stdlib.h>
+#include <math.h>
+
 /*============================================================================================================
  *
  *
  * 
  *==========================================================================================================*/
 
-static inline MC_BOOL is_idx_in_render_distance (int ix, int iy, int iz) {
-    if (ix < 0) return MC_FALSE;
-    if (iy < 0) return MC_FALSE;
-    if (iz < 0) return MC_FALSE;
-    if (ix >= MC_RENDER_DISTANCE) return MC_FALSE;
-    if (iy >= MC_WORLD_HEIGHT   ) return MC_FALSE;
-    if (iz >= MC_RENDER_DISTANCE) return MC_FALSE;
-    return MC_TRUE;
-}
-
-static inline MC_BOOL coord_to_idx (struct mc_World * wd, int x, int y, int z, int * ixPtr, int * iyPtr, int * izPtr) {
-    assert(wd != NULL);
-    assert(ixPtr != NULL);
-    assert(iyPtr != NULL);
-    assert(izPtr != NULL);
-    *ixPtr = abs(x) % MC_RENDER_DISTANCE;
-    *iyPtr = abs(y) % MC_WORLD_HEIGHT;
-    *izPtr = abs(z) % MC_RENDER_DISTANCE;
-    if (x < 0) *ixPtr = MC_RENDER_DISTANCE - *ixPtr;
-    if (y < 0) *iyPtr = MC_WORLD_HEIGHT    - *iyPtr;
-    if (z < 0) *izPtr = MC_RENDER_DISTANCE - *izPtr;
-    return is_idx_in_render_distance(
-        x - wd->offset[0],
-        y - wd->offset[1],
-        z - wd->offset[2]
+static const int face_dirs[MC_BLOCK_FACES][3] = {
+    [MC_BLOCK_FACE_LEFT  ] = {-1, 0, 0},
+    [MC_BLOCK_FACE_RIGHT ] = { 1, 0, 0},
+    [MC_BLOCK_FACE_BOTTOM] = { 0,-1, 0},
+    [MC_BLOCK_FACE_TOP   ] = { 0, 1, 0},
+    [MC_BLOCK_FACE_BACK  ] = { 0, 0,-1},
+    [MC_BLOCK_FACE_FRONT ] = { 0, 0, 1}
+};
+
+static inline int block_to_chunk (int xyz) {
+    return xyz >> MC_CHUNK_SIZE_LOG2; // floor division, also for negative coordinates
+}
+
+static inline int block_to_local (int xyz) {
+    return xyz & (MC_CHUNK_SIZE - 1);
+}
+
+static inline MC_BOOL is_local_in_chunk (int lx, int ly, int lz) {
+    return ((unsigned)lx < MC_CHUNK_SIZE) && ((unsigned)ly < MC_CHUNK_SIZE) && ((unsigned)lz < MC_CHUNK_SIZE);
+}
+
+static inline struct mc_Chunk * neighbour_at (struct mc_World * wd, const struct mc_Chunk * chunk, enum mc_BlockFace f) {
+    assert(wd != NULL);
+    assert(chunk != NULL);
+    return mc_world_chunk_at(wd,
+        chunk->pos[0] + face_dirs[f][0],
+        chunk->pos[1] + face_dirs[f][1],
+        chunk->pos[2] + face_dirs[f][2]
     );
 }
 
-static inline struct mc_Block * block_at_idx (struct mc_World * wd, int ix, int iy, int iz) {
-    return &wd->blocks[
-        (ix * MC_RENDER_DISTANCE * MC_WORLD_HEIGHT) +
-        (iy * MC_RENDER_DISTANCE) +
-        (iz)
-    ];
+// the chunk is meshed again by the stream, the meshes that are being built of it are dropped when they're done
+static void dirty_chunk (struct mc_World * wd, struct mc_Chunk * chunk) {
+    assert(wd != NULL);
+    assert(chunk != NULL);
+    chunk->dirty = MC_TRUE;
+    chunk->version = ++wd->versions;
+    if (chunk->version == 0)
+        chunk->version = ++wd->versions; // 0 is for no mesh being built, see mc_Chunk.meshing
 }
 
-static GLintptr next_face_index (struct mc_World * wd) {
+// the faces on the sides of the neighbours depend on the blocks of this chunk that touch them
+static void mark_neighbours_dirty (struct mc_World * wd, const struct mc_Chunk * chunk) {
     assert(wd != NULL);
-    if (wd->free_face_indices_top > 0)
-        return wd->free_face_indices[--wd->free_face_indices_top];
-    return wd->face_indices_top++;
+    assert(chunk != NULL);
+    if (chunk->occupancy == mc_chunk_occupancy_empty)
+        return;
+    for (int f = 0; f < MC_BLOCK_FACES; f++) {
+        struct mc_Chunk * neighbour = neighbour_at(wd, chunk, f);
+        if (neighbour == NULL)
+            continue;
+        uint32_t rows[MC_CHUNK_SIZE], any = 0;
+        mc_chunk_border(chunk, f, rows);
+        for (int i = 0; i < MC_CHUNK_SIZE; i++)
+            any |= rows[i];
+        if (any != 0)
+            dirty_chunk(wd, neighbour);
+    }
 }
 
-static void free_face_index (struct mc_World * wd, GLintptr face_idx) {
+// what the loaded neighbours of the chunk at (cx, cy, cz) have on their sides facing it, malloc'ed for the stream
+static struct mc_ChunkBorders * borders_at (struct mc_World * wd, int cx, int cy, int cz) {
     assert(wd != NULL);
-    assert(wd->free_face_indices_top < MC_WORLD_MAX_FACES);
-    wd->free_face_indices[wd->free_face_indices_top++] = face_idx;
+    struct mc_ChunkBorders * borders = malloc(sizeof(*borders));
+    assert(borders != NULL);
+    for (int f = 0; f < MC_BLOCK_FACES; f++) {
+        struct mc_Chunk * neighbour = mc_world_chunk_at(wd, cx + face_dirs[f][0], cy + face_dirs[f][1], cz + face_dirs[f][2]);
+        if (neighbour != NULL)
+            mc_chunk_border(neighbour, MC_BLOCK_FACE_OPPOSITE(f), borders->rows[f]);
+        else
+            memset(borders->rows[f], 0, sizeof(borders->rows[f]));
+    }
+    return borders;
 }
 
-static void send_block (struct mc_World * wd, struct mc_Block * block, float x_, float y_, float z_, float a_left, float a_right, float a_top, float a_bottom, float a_front, float a_back) {
+/*============================================================================================================
+ *
+ * Face slots
+ * Every chunk owns a contiguous range of face slots in the VBO (chunk->mesh_first, mesh_cap),
+ * wd->slots keeps track of the slots in use and new ranges go to the lowest free run that fits,
+ * so the used part of the VBO stays packed at its start (see also compact_faces)
+ *
+ *==========================================================================================================*/
+
+#define MC_WORLD_BUFFER_FACES (MC_WORLD_MAX_VERTICES / MC_BLOCK_FACE_VERTICES) // vertices take more room than face records
+
+// what a face slot holds in the VBO in the current mode
+static inline size_t face_size (const struct mc_World * wd) {
     assert(wd != NULL);
-    assert(block != NULL);
+    return wd->pulling ? sizeof(struct mc_FaceRecord) : MC_BLOCK_FACE_VERTICES * sizeof(struct mc_BlockVertex);
+}
 
-    float x = (float)x_ * MC_BLOCK_SIZE;
-    float y = (float)y_ * MC_BLOCK_SIZE;
-    float z = (float)z_ * MC_BLOCK_SIZE;
-    float x2 = x + MC_BLOCK_SIZE;
-	float y2 = y + MC_BLOCK_SIZE;
-	float z2 = z + MC_BLOCK_SIZE;
+// points the vertex attribute and the buffer texture at wd->VBO
+static void attach_vbo (struct mc_World * wd) {
+    assert(wd != NULL);
+	glBindVertexArray(wd->VAO);
+	glBindBuffer(GL_ARRAY_BUFFER, wd->VBO);
+	glEnableVertexAttribArray(0);
+	glVertexAttribIPointer(0, 1, GL_UNSIGNED_INT, sizeof(struct mc_BlockVertex), (void *)offsetof(struct mc_BlockVertex, data));
+    glActiveTexture(GL_TEXTURE0 + MC_WORLD_FACES_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_BUFFER, wd->faces_tex);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RG32UI, wd->VBO);
+}
 
-    static float face[][6] = { // front, back, top, bottom, left, right
-        {0, 0, 1, 2, 0, 0} // grass
-    };
-    size_t i = (size_t)block->type;
-    float t = 1.0f / (float)MC_BLOCKTEX_BLOCKS;
-    float tex_front = (MC_BLOCKTEX_BLOCKS - 1 - face[i][0]) * t;
-    float tex_back  = (MC_BLOCKTEX_BLOCKS - 1 - face[i][1]) * t;
-    float tex_top   = (MC_BLOCKTEX_BLOCKS - 1 - face[i][2]) * t;
-    float tex_bot   = (MC_BLOCKTEX_BLOCKS - 1 - face[i][3]) * t;
-    float tex_left  = (MC_BLOCKTEX_BLOCKS - 1 - face[i][4]) * t;
-    float tex_right = (MC_BLOCKTEX_BLOCKS - 1 - face[i][5]) * t;
-
-    glBindBuffer(GL_ARRAY_BUFFER, wd->VBO);
-
-    if (block->face_idx_back != 0) { // -Z
-        float vertices[] = {
-            x,  y,  z, /**/ 0,(tex_back+0), /**/ a_back,
-            x2, y2, z, /**/ 1,(tex_back+t), /**/ a_back,
-            x2, y,  z, /**/ 1,(tex_back+0), /**/ a_back,
-            x2, y2, z, /**/ 1,(tex_back+t), /**/ a_back,
-            x,  y,  z, /**/ 0,(tex_back+0), /**/ a_back,
-            x,  y2, z, /**/ 0,(tex_back+t), /**/ a_back
-        };
-        glBufferSubData(GL_ARRAY_BUFFER, block->face_idx_back * MC_BLOCK_FACE_VERTICES * sizeof(struct mc_BlockVertex), sizeof(vertices), vertices);
-    }
-    if (block->face_idx_front != 0) { // +Z
-        float vertices[] = {
-            x,  y,  z2, /**/ 0,(tex_front+0), /**/ a_front,
-            x2, y,  z2, /**/ 1,(tex_front+0), /**/ a_front,
-            x2, y2, z2, /**/ 1,(tex_front+t), /**/ a_front,
-            x2, y2, z2, /**/ 1,(tex_front+t), /**/ a_front,
-            x,  y2, z2, /**/ 0,(tex_front+t), /**/ a_front,
-            x,  y,  z2, /**/ 0,(tex_front+0), /**/ a_front
-        };
-        glBufferSubData(GL_ARRAY_BUFFER, block->face_idx_front * MC_BLOCK_FACE_VERTICES * sizeof(struct mc_BlockVertex), sizeof(vertices), vertices);
-    }
-    if (block->face_idx_left != 0) { // -X
-        float vertices[] = {
-            x, y2, z2, /**/ 1,(tex_left+t), /**/ a_left,
-            x, y2, z,  /**/ 0,(tex_left+t), /**/ a_left,
-            x, y,  z,  /**/ 0,(tex_left+0), /**/ a_left,
-            x, y,  z,  /**/ 0,(tex_left+0), /**/ a_left,
-            x, y,  z2, /**/ 1,(tex_left+0), /**/ a_left,
-            x, y2, z2, /**/ 1,(tex_left+t), /**/ a_left
-        };
-        glBufferSubData(GL_ARRAY_BUFFER, block->face_idx_left * MC_BLOCK_FACE_VERTICES * sizeof(struct mc_BlockVertex), sizeof(vertices), vertices);
-    }
-    if (block->face_idx_right != 0) { // +X
-        float vertices[] = {
-            x2, y2, z2, /**/ 1,(tex_right+t), /**/ a_right,
-            x2, y,  z,  /**/ 0,(tex_right+0), /**/ a_right,
-            x2, y2, z,  /**/ 0,(tex_right+t), /**/ a_right,
-            x2, y,  z,  /**/ 0,(tex_right+0), /**/ a_right,
-            x2, y2, z2, /**/ 1,(tex_right+t), /**/ a_right,
-            x2, y,  z2, /**/ 1,(tex_right+0), /**/ a_right
-        };
-        glBufferSubData(GL_ARRAY_BUFFER, block->face_idx_right * MC_BLOCK_FACE_VERTICES * sizeof(struct mc_BlockVertex), sizeof(vertices), vertices);
-    }
-    if (block->face_idx_bottom != 0) { // -Y
-        float vertices[] = {
-            x,  y, z,  /**/ 0,(tex_bot+t), /**/ a_bottom,
-            x2, y, z,  /**/ 1,(tex_bot+t), /**/ a_bottom,
-            x2, y, z2, /**/ 1,(tex_bot+0), /**/ a_bottom,
-            x2, y, z2, /**/ 1,(tex_bot+0), /**/ a_bottom,
-            x,  y, z2, /**/ 0,(tex_bot+0), /**/ a_bottom,
-            x,  y, z,  /**/ 0,(tex_bot+t), /**/ a_bottom
-        };
-        glBufferSubData(GL_ARRAY_BUFFER, block->face_idx_bottom * MC_BLOCK_FACE_VERTICES * sizeof(struct mc_BlockVertex), sizeof(vertices), vertices);
-    }
-    if (block->face_idx_top != 0) { // +Y
-        float vertices[] = {
-            x,  y2, z,  /**/ 0,(tex_top+t), /**/ a_top,
-            x2, y2, z2, /**/ 1,(tex_top+0), /**/ a_top,
-            x2, y2, z,  /**/ 1,(tex_top+t), /**/ a_top,
-            x2, y2, z2, /**/ 1,(tex_top+0), /**/ a_top,
-            x,  y2, z,  /**/ 0,(tex_top+t), /**/ a_top,
-            x,  y2, z2, /**/ 0,(tex_top+0), /**/ a_top
-        };
-        glBufferSubData(GL_ARRAY_BUFFER, block->face_idx_top * MC_BLOCK_FACE_VERTICES * sizeof(struct mc_BlockVertex), sizeof(vertices), vertices);
+/*
+ * Replaces the VBO (and the shadow) with one of `size` bytes, the used part is copied over on the GPU.
+ * Called before new ranges are written past the end and after compact_faces has freed enough of it.
+ */
+static void resize_vbo (struct mc_World * wd, size_t size) {
+    assert(wd != NULL);
+    assert(size >= (size_t)wd->slots.top * face_size(wd));
+    GLuint vbo;
+    glGenBuffers(1, &vbo);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, vbo);
+    glBufferData(GL_COPY_WRITE_BUFFER, size, NULL, GL_DYNAMIC_DRAW);
+    size_t used = (size_t)wd->slots.top * face_size(wd);
+    if (used > 0) {
+        glBindBuffer(GL_COPY_READ_BUFFER, wd->VBO);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, used);
+    }
+    glDeleteBuffers(1, &wd->VBO);
+    wd->VBO = vbo;
+    wd->vbo_size = size;
+    attach_vbo(wd);
+
+    wd->shadow = realloc(wd->shadow, size);
+    assert(wd->shadow != NULL);
+    wd->shadow_valid = MC_MIN(wd->shadow_valid, used);
+    wd->vbo_resizes++;
+}
+
+// doubles the VBO until `bytes` fit
+static void grow_vbo (struct mc_World * wd, size_t bytes) {
+    assert(wd != NULL);
+    size_t size = wd->vbo_size;
+    while (size < bytes)
+        size *= 2;
+    if (size != wd->vbo_size)
+        resize_vbo(wd, size);
+}
+
+// halves the VBO while the used part takes up a quarter of it at most
+static void shrink_vbo (struct mc_World * wd) {
+    assert(wd != NULL);
+    size_t used = (size_t)wd->slots.top * face_size(wd);
+    size_t size = wd->vbo_size;
+    while ((size / 2 >= MC_WORLD_MIN_VBO_SIZE) && (used <= size / 4))
+        size /= 2;
+    if (size != wd->vbo_size)
+        resize_vbo(wd, size);
+}
+
+static uint32_t alloc_faces (struct mc_World * wd, uint32_t count) {
+    assert(wd != NULL);
+    assert(count > 0);
+    uint32_t first = mc_slots_find(&wd->slots, count);
+    assert(first + count <= MC_WORLD_BUFFER_FACES);
+    grow_vbo(wd, (size_t)(first + count) * face_size(wd));
+    mc_slots_take(&wd->slots, first, count);
+    return first;
+}
+
+static void free_faces (struct mc_World * wd, uint32_t first, uint32_t count) {
+    assert(wd != NULL);
+    mc_slots_release(&wd->slots, first, count);
+}
+
+static void free_chunk_faces (struct mc_World * wd, struct mc_Chunk * chunk) {
+    assert(wd != NULL);
+    assert(chunk != NULL);
+    free_faces(wd, chunk->mesh_first, chunk->mesh_cap);
+    wd->faces_count -= chunk->mesh_faces;
+    chunk->mesh_first = 0;
+    chunk->mesh_faces = 0;
+    memset(chunk->mesh_dir_faces, 0, sizeof(chunk->mesh_dir_faces));
+    chunk->mesh_translucent = 0;
+    chunk->mesh_cap = 0;
+}
+
+/*============================================================================================================
+ *
+ * Shadow buffer
+ * The chunks are written into wd->shadow, only the runs of face slots that differ from what's there are marked dirty,
+ * once per draw the dirty ranges are sorted, merged and sent through the upload ring
+ *
+ *==========================================================================================================*/
+
+static void mark_dirty (struct mc_World * wd, uint32_t first, uint32_t count) {
+    assert(wd != NULL);
+    if (wd->dirty_ranges_count == wd->dirty_ranges_cap) {
+        wd->dirty_ranges_cap = (wd->dirty_ranges_cap == 0) ? 64 : wd->dirty_ranges_cap * 2;
+        wd->dirty_ranges = realloc(wd->dirty_ranges, sizeof(*wd->dirty_ranges) * wd->dirty_ranges_cap);
+        assert(wd->dirty_ranges != NULL);
+    }
+    wd->dirty_ranges[wd->dirty_ranges_count++] = (struct mc_FaceRange){first, count};
+    wd->upload_stats.runs++;
+    wd->upload_stats.run_bytes += (size_t)count * face_size(wd);
+}
+
+// copies `count` faces to face slot `first` of the shadow
+static void write_shadow (struct mc_World * wd, uint32_t first, uint32_t count, const void * data) {
+    assert(wd != NULL);
+    assert(data != NULL);
+    size_t fs = face_size(wd);
+    size_t end = (size_t)(first + count) * fs;
+    assert(end <= wd->vbo_size);
+
+    unsigned char * dst = wd->shadow + (size_t)first * fs;
+    const unsigned char * src = data;
+    uint32_t known = (wd->shadow_valid > (size_t)first * fs) ? (uint32_t)MC_MIN(count, (wd->shadow_valid - (size_t)first * fs) / fs) : 0;
+    for (uint32_t i = 0; i < count;) {
+        while ((i < known) && (memcmp(dst + i * fs, src + i * fs, fs) == 0))
+            i++;
+        uint32_t start = i;
+        while ((i < count) && ((i >= known) || (memcmp(dst + i * fs, src + i * fs, fs) != 0)))
+            i++;
+        if (i > start) {
+            memcpy(dst + start * fs, src + start * fs, (i - start) * fs);
+            mark_dirty(wd, first + start, i - start);
+        }
+    }
+    wd->shadow_valid = MC_MAX(wd->shadow_valid, end);
+}
+
+static int compare_ranges (const void * a, const void * b) {
+    uint32_t fa = ((const struct mc_FaceRange *)a)->first;
+    uint32_t fb = ((const struct mc_FaceRange *)b)->first;
+    return (fa > fb) - (fa < fb);
+}
+
+// ranges closer than MC_WORLD_DIRTY_GAP are sent as one, as long as that stays within MC_WORLD_UPLOAD_BUDGET
+static void flush_shadow (struct mc_World * wd) {
+    assert(wd != NULL);
+    if (wd->dirty_ranges_count == 0)
+        return;
+    qsort(wd->dirty_ranges, wd->dirty_ranges_count, sizeof(*wd->dirty_ranges), compare_ranges);
+    size_t fs = face_size(wd);
+    uint32_t max_faces = MC_WORLD_UPLOAD_BUDGET / fs;
+    for (size_t i = 0; i < wd->dirty_ranges_count;) {
+        uint32_t first = wd->dirty_ranges[i].first;
+        uint32_t end = first + wd->dirty_ranges[i].count;
+        for (i++; i < wd->dirty_ranges_count; i++) {
+            const struct mc_FaceRange * next = &wd->dirty_ranges[i];
+            if ((next->first > end + MC_WORLD_DIRTY_GAP) || (next->first + next->count - first > max_faces))
+                break;
+            end = MC_MAX(end, next->first + next->count);
+        }
+
+        size_t bytes = (size_t)(end - first) * fs;
+        GLintptr staged;
+        void * p = mc_upload_map_wait(wd->upload, bytes, &staged);
+        if (p != NULL) {
+            memcpy(p, wd->shadow + (size_t)first * fs, bytes);
+            mc_upload_unmap(wd->upload);
+            mc_upload_copy(wd->upload, staged, wd->VBO, (GLintptr)first * fs, bytes);
+        }
+        else {
+            // the ring can't take it, the driver has to
+            glBindBuffer(GL_COPY_WRITE_BUFFER, wd->VBO);
+            glBufferSubData(GL_COPY_WRITE_BUFFER, (GLintptr)first * fs, bytes, wd->shadow + (size_t)first * fs);
+        }
+        wd->upload_stats.copies++;
+        wd->upload_stats.bytes += bytes;
+    }
+    wd->dirty_ranges_count = 0;
+}
+
+/*
+ * Writes the mesh of the chunk (as face records or vertices) into the shadow buffer.
+ * The chunk keeps its range as long as the mesh fits and doesn't shrink to a fraction of it,
+ * otherwise it moves to a new range with some room to grow.
+ */
+static void upload_chunk (struct mc_World * wd, struct mc_Chunk * chunk, struct mc_Mesh * mesh) {
+    assert(wd != NULL);
+    assert(chunk != NULL);
+    assert(mesh != NULL);
+
+    uint32_t faces = mesh->faces;
+    assert(faces <= MC_CHUNK_MAX_FACES);
+    if ((faces > chunk->mesh_cap) || (faces < chunk->mesh_cap / 4)) {
+        free_chunk_faces(wd, chunk);
+        if (faces > 0) {
+            chunk->mesh_cap = faces + faces / 4;
+            chunk->mesh_first = alloc_faces(wd, chunk->mesh_cap);
+        }
+    }
+    wd->faces_count += (size_t)faces - chunk->mesh_faces;
+    chunk->mesh_faces = faces;
+    memcpy(chunk->mesh_dir_faces, mesh->dir_faces, sizeof(chunk->mesh_dir_faces));
+    chunk->mesh_translucent = mesh->translucent_faces;
+    if (faces == 0)
+        return;
+
+    const void * data = mesh->records;
+    if (!wd->pulling) {
+        mc_mesh_expand(mesh);
+        data = mesh->vertices;
+    }
+    size_t bytes = (size_t)faces * face_size(wd);
+    wd->upload_bytes += bytes;
+    wd->upload_stats.meshed_bytes += bytes;
+    write_shadow(wd, chunk->mesh_first, faces, data);
+}
+
+// the faces of the indicator block are written again only when its type changes
+static void upload_indicator (struct mc_World * wd) {
+    assert(wd != NULL);
+    if ((wd->indicator == MC_BLOCK_TYPE_NONE) || (wd->indicator == wd->indicator_written))
+        return;
+    mc_mesh_block(&wd->mesh, wd->indicator);
+    const void * data = wd->mesh.records;
+    if (!wd->pulling) {
+        mc_mesh_expand(&wd->mesh);
+        data = wd->mesh.vertices;
+    }
+    write_shadow(wd, wd->indicator_first, MC_BLOCK_FACES, data);
+    wd->indicator_written = wd->indicator;
+}
+
+// hands a copy of every changed chunk to the stream, one mesh per chunk at a time
+static void mesh_dirty_chunks (struct mc_World * wd) {
+    assert(wd != NULL);
+    for (size_t i = 0; i < wd->chunks.cap; i++) {
+        struct mc_Chunk * chunk = wd->chunks.entries[i];
+        if ((chunk == NULL) || !chunk->dirty || (chunk->meshing != 0))
+            continue;
+        struct mc_ChunkBorders * borders = borders_at(wd, chunk->pos[0], chunk->pos[1], chunk->pos[2]);
+        mc_stream_mesh(&wd->stream, mc_chunk_clone(chunk), borders, wd->greedy, chunk->version);
+        chunk->dirty = MC_FALSE;
+        chunk->meshing = chunk->version;
+    }
+}
+
+/*
+ * Moves the chunks at the end of the used part of the VBO down into the lowest holes they fit in,
+ * up to MC_WORLD_COMPACT_FACES faces per draw, so slots.top follows the faces actually in use.
+ * A chunk that shrank gives the slots it no longer needs back on the way.
+ * Right after flush_shadow the shadow and the VBO are the same, the live faces are copied in both.
+ */
+static void compact_faces (struct mc_World * wd) {
+    assert(wd != NULL);
+    assert(wd->dirty_ranges_count == 0);
+    size_t fs = face_size(wd);
+    for (uint32_t moved = 0; moved < MC_WORLD_COMPACT_FACES;) {
+        struct mc_Chunk * last = NULL;
+        for (size_t i = 0; i < wd->chunks.cap; i++) {
+            struct mc_Chunk * chunk = wd->chunks.entries[i];
+            if ((chunk != NULL) && (chunk->mesh_cap > 0) && ((last == NULL) || (chunk->mesh_first > last->mesh_first)))
+                last = chunk;
+        }
+        if (last == NULL)
+            return;
+        uint32_t cap = last->mesh_faces + last->mesh_faces / 4;
+        if (cap < last->mesh_cap) {
+            free_faces(wd, last->mesh_first + cap, last->mesh_cap - cap);
+            last->mesh_cap = cap;
+            if (cap == 0) {
+                last->mesh_first = 0;
+                continue;
+            }
+        }
+        uint32_t first = mc_slots_find(&wd->slots, last->mesh_cap);
+        if (first >= last->mesh_first)
+            return;
+
+        mc_slots_take(&wd->slots, first, last->mesh_cap);
+        if (last->mesh_faces > 0) {
+            size_t bytes = (size_t)last->mesh_faces * fs;
+            memcpy(wd->shadow + (size_t)first * fs, wd->shadow + (size_t)last->mesh_first * fs, bytes);
+            glBindBuffer(GL_COPY_READ_BUFFER, wd->VBO);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, wd->VBO);
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, (GLintptr)last->mesh_first * fs, (GLintptr)first * fs, bytes);
+        }
+        free_faces(wd, last->mesh_first, last->mesh_cap);
+        last->mesh_first = first;
+        moved += last->mesh_cap;
+    }
+}
+
+/*
+ * Adds a chunk built by mc_stream_build to the world along with its mesh and takes it from the job.
+ * It's meshed again if its neighbours or the meshing changed since the job was queued, and so are the neighbours it touches.
+ */
+static struct mc_Chunk * install_chunk (struct mc_World * wd, struct mc_StreamJob * job) {
+    assert(wd != NULL);
+    assert(job != NULL);
+    assert(job->kind == MC_STREAM_JOB_GENERATE);
+    struct mc_Chunk * chunk = job->chunk;
+    job->chunk = NULL;
+    mc_chunkmap_insert(&wd->chunks, chunk);
+    dirty_chunk(wd, chunk); // for a version of its own
+    chunk->dirty = MC_FALSE;
+    chunk->solid_cells = job->solid_cells;
+    memcpy(chunk->links, job->links, sizeof(chunk->links));
+    upload_chunk(wd, chunk, &job->mesh);
+
+    struct mc_ChunkBorders * borders = borders_at(wd, chunk->pos[0], chunk->pos[1], chunk->pos[2]);
+    if ((memcmp(borders, job->borders, sizeof(*borders)) != 0) || (job->greedy != wd->greedy))
+        dirty_chunk(wd, chunk);
+    free(borders);
+    mark_neighbours_dirty(wd, chunk);
+    return chunk;
+}
+
+// the mesh of a loaded chunk, unless the chunk has changed again or was unloaded meanwhile
+static void install_mesh (struct mc_World * wd, struct mc_StreamJob * job) {
+    assert(wd != NULL);
+    assert(job != NULL);
+    assert(job->kind == MC_STREAM_JOB_MESH);
+    struct mc_Chunk * chunk = mc_world_chunk_at(wd, job->pos[0], job->pos[1], job->pos[2]);
+    if (chunk == NULL)
+        return;
+    if (chunk->meshing == job->version)
+        chunk->meshing = 0;
+    if (chunk->version != job->version)
+        return;
+    chunk->solid_cells = job->solid_cells;
+    memcpy(chunk->links, job->links, sizeof(chunk->links));
+    upload_chunk(wd, chunk, &job->mesh);
+}
+
+/*============================================================================================================
+ *
+ * Culling
+ * Every draw gathers the chunks with faces that can be seen from the camera's chunk into wd->draw_list,
+ * each step then drops the ones it can tell aren't visible, what's left is drawn
+ *
+ *==========================================================================================================*/
+
+static void push_draw (struct mc_World * wd, struct mc_Chunk * chunk) {
+    assert(wd != NULL);
+    assert(chunk != NULL);
+    if (wd->draw_count == wd->draw_cap) {
+        wd->draw_cap = MC_MAX(MC_FRUSTUM_LANES * 16, wd->draw_cap * 2);
+        wd->draw_list    = realloc(wd->draw_list,    sizeof(*wd->draw_list)    * wd->draw_cap);
+        wd->draw_boxes   = realloc(wd->draw_boxes,   sizeof(*wd->draw_boxes)   * wd->draw_cap * 6);
+        wd->draw_visible = realloc(wd->draw_visible, sizeof(*wd->draw_visible) * wd->draw_cap);
+        wd->draw_depths  = realloc(wd->draw_depths,  sizeof(*wd->draw_depths)  * wd->draw_cap * 2);
+        assert((wd->draw_list != NULL) && (wd->draw_boxes != NULL) && (wd->draw_visible != NULL) && (wd->draw_depths != NULL));
+    }
+    wd->draw_list[wd->draw_count++] = chunk;
+}
+
+/*
+ * Breadth first search from the camera's chunk, a chunk is left through face g after being entered through face f
+ * only if its links say f and g are connected, and never back against a direction already taken.
+ * Only the chunks with faces that it reaches go to wd->draw_list, all of them if the camera's chunk isn't loaded.
+ */
+static void gather_chunks (struct mc_World * wd, vec3 eye) {
+    assert(wd != NULL);
+    wd->draw_count = 0;
+    wd->cull_stats.chunks = 0;
+    for (size_t i = 0; i < wd->chunks.cap; i++)
+        if ((wd->chunks.entries[i] != NULL) && (wd->chunks.entries[i]->mesh_faces > 0))
+            wd->cull_stats.chunks++;
+
+    struct mc_Chunk * start = mc_world_chunk_at(wd, block_to_chunk((int)floorf(eye[0])), block_to_chunk((int)floorf(eye[1])), block_to_chunk((int)floorf(eye[2])));
+    if (start == NULL) {
+        for (size_t i = 0; i < wd->chunks.cap; i++)
+            if ((wd->chunks.entries[i] != NULL) && (wd->chunks.entries[i]->mesh_faces > 0))
+                push_draw(wd, wd->chunks.entries[i]);
+        wd->cull_stats.cave_culled = 0;
+        return;
+    }
+
+    if (wd->visits_cap < wd->chunks.count) {
+        wd->visits_cap = wd->chunks.cap;
+        wd->visits = realloc(wd->visits, sizeof(*wd->visits) * wd->visits_cap);
+        assert(wd->visits != NULL);
+    }
+    if (++wd->draws == 0)
+        wd->draws = 1; // 0 is what new chunks start with
+    size_t head = 0, tail = 0;
+    start->visit = wd->draws;
+    wd->visits[tail++] = (struct mc_ChunkVisit){.chunk = start, .from = MC_BLOCK_FACES, .dirs = 0};
+    while (head < tail) {
+        struct mc_ChunkVisit v = wd->visits[head++];
+        if (v.chunk->mesh_faces > 0)
+            push_draw(wd, v.chunk);
+        for (int f = 0; f < MC_BLOCK_FACES; f++) {
+            if (v.dirs & (1 << MC_BLOCK_FACE_OPPOSITE(f)))
+                continue;
+            if ((v.from != MC_BLOCK_FACES) && !(v.chunk->links[v.from] & (1 << f)))
+                continue;
+            struct mc_Chunk * next = neighbour_at(wd, v.chunk, f);
+            if ((next == NULL) || (next->visit == wd->draws))
+                continue;
+            next->visit = wd->draws;
+            wd->visits[tail++] = (struct mc_ChunkVisit){.chunk = next, .from = MC_BLOCK_FACE_OPPOSITE(f), .dirs = v.dirs | (1 << f)};
+        }
+    }
+    wd->cull_stats.cave_culled = wd->cull_stats.chunks - wd->draw_count;
+}
+
+// keeps the chunks of wd->draw_list that wd->draw_visible says can be seen, in the same order
+static void keep_visible (struct mc_World * wd) {
+    assert(wd != NULL);
+    size_t n = 0;
+    for (size_t i = 0; i < wd->draw_count; i++)
+        if (wd->draw_visible[i])
+            wd->draw_list[n++] = wd->draw_list[i];
+    wd->draw_count = n;
+}
+
+static void cull_frustum (struct mc_World * wd, mat4 viewproj) {
+    assert(wd != NULL);
+    struct mc_Frustum frustum;
+    mc_frustum_from_matrix(&frustum, viewproj);
+
+    // whole chunks for now, padded up to a multiple of MC_FRUSTUM_LANES with empty boxes at the origin
+    const float * box[6];
+    size_t padded = (wd->draw_count + MC_FRUSTUM_LANES - 1) / MC_FRUSTUM_LANES * MC_FRUSTUM_LANES;
+    const float half = MC_CHUNK_SIZE * MC_BLOCK_SIZE * 0.5f;
+    for (int k = 0; k < 6; k++) {
+        float * b = &wd->draw_boxes[wd->draw_cap * k];
+        for (size_t i = 0; i < padded; i++) {
+            if (i >= wd->draw_count)
+                b[i] = 0.0f;
+            else if (k < 3)
+                b[i] = wd->draw_list[i]->pos[k] * MC_CHUNK_SIZE * MC_BLOCK_SIZE + half;
+            else
+                b[i] = half;
+        }
+        box[k] = b;
+    }
+    size_t visible = mc_frustum_cull(&frustum, box, wd->draw_count, wd->draw_visible);
+    wd->cull_stats.frustum_culled = wd->draw_count - visible;
+    keep_visible(wd);
+}
+
+/*
+ * Rasterizes the chunks around the camera into wd->occlusion and drops the chunks hidden behind them.
+ * Only the chunks that passed the frustum test can occlude, the ones outside it can't hide anything anyway.
+ */
+static void cull_occlusion (struct mc_World * wd, mat4 viewproj, vec3 eye) {
+    assert(wd != NULL);
+    vec3 eye_world;
+    glm_vec3_scale(eye, MC_BLOCK_SIZE, eye_world);
+    mc_occlusion_begin(&wd->occlusion, viewproj, eye_world);
+    int cam[3] = {block_to_chunk((int)floorf(eye[0])), block_to_chunk((int)floorf(eye[1])), block_to_chunk((int)floorf(eye[2]))};
+    for (size_t i = 0; i < wd->draw_count; i++) {
+        const struct mc_Chunk * chunk = wd->draw_list[i];
+        if ((chunk->solid_cells != 0)
+         && (abs(chunk->pos[0] - cam[0]) <= MC_WORLD_OCCLUDER_RANGE)
+         && (abs(chunk->pos[1] - cam[1]) <= MC_WORLD_OCCLUDER_RANGE)
+         && (abs(chunk->pos[2] - cam[2]) <= MC_WORLD_OCCLUDER_RANGE))
+            mc_occlusion_add_chunk(&wd->occlusion, chunk);
+    }
+    mc_occlusion_finish(&wd->occlusion);
+
+    const float size = MC_CHUNK_SIZE * MC_BLOCK_SIZE;
+    size_t visible = 0;
+    for (size_t i = 0; i < wd->draw_count; i++) {
+        const struct mc_Chunk * chunk = wd->draw_list[i];
+        vec3 min = {chunk->pos[0] * size, chunk->pos[1] * size, chunk->pos[2] * size}, max;
+        glm_vec3_adds(min, size, max);
+        wd->draw_visible[i] = mc_occlusion_visible(&wd->occlusion, min, max);
+        visible += wd->draw_visible[i];
+    }
+    wd->cull_stats.occlusion_culled = wd->draw_count - visible;
+    wd->cull_stats.occluders = wd->occlusion.occluders;
+    keep_visible(wd);
+}
+
+/*
+ * The directions of the faces of `chunk` that may face `eye` (in blocks), as a mask of 1 << face.
+ * The faces towards -X lie on the planes x0 .. x0 + 31 and the ones towards +X on x0 + 1 .. x0 + 32,
+ * the camera sees none of them from the other side of all of these planes.
+ */
+static uint32_t facing_dirs (const struct mc_Chunk * chunk, vec3 eye) {
+    assert(chunk != NULL);
+    uint32_t dirs = 0;
+    for (int a = 0; a < 3; a++) {
+        float lo = (float)(chunk->pos[a] * MC_CHUNK_SIZE);
+        if (eye[a] < lo + MC_CHUNK_SIZE - 1)
+            dirs |= 1u << (a * 2);
+        if (eye[a] > lo + 1)
+            dirs |= 1u << (a * 2 + 1);
     }
+    return dirs;
+}
+
+// draws the opaque faces of `chunk` in the directions of `dirs`, the neighbouring ones in a single range
+static void draw_chunk (struct mc_World * wd, const struct mc_Chunk * chunk, uint32_t dirs) {
+    assert(wd != NULL);
+    assert(chunk != NULL);
+    GLsizei counts[MC_BLOCK_FACES];
+    GLint base[MC_BLOCK_FACES];
+    const void * indices[MC_BLOCK_FACES] = {NULL};
+    GLsizei ranges = 0;
+    uint32_t first = chunk->mesh_first;
+    MC_BOOL open = MC_FALSE; // the last range can be extended
+    for (int f = 0; f < MC_BLOCK_FACES; f++) {
+        uint32_t n = chunk->mesh_dir_faces[f];
+        if (n == 0)
+            continue;
+        if (!(dirs & (1u << f))) {
+            wd->cull_stats.facing_away += n;
+            open = MC_FALSE;
+        }
+        else if (open)
+            counts[ranges - 1] += n * MC_BLOCK_FACE_INDICES;
+        else {
+            counts[ranges] = n * MC_BLOCK_FACE_INDICES;
+            base[ranges] = first * MC_BLOCK_FACE_VERTICES;
+            ranges++;
+            open = MC_TRUE;
+        }
+        first += n;
+    }
+    assert(first + chunk->mesh_translucent == chunk->mesh_first + chunk->mesh_faces);
+    for (GLsizei r = 0; r < ranges; r++)
+        wd->cull_stats.drawn_faces += counts[r] / MC_BLOCK_FACE_INDICES;
+    if (ranges == 1)
+        glDrawElementsBaseVertex(GL_TRIANGLES, counts[0], GL_UNSIGNED_INT, NULL, base[0]);
+    else if (ranges > 1)
+        glMultiDrawElementsBaseVertex(GL_TRIANGLES, counts, GL_UNSIGNED_INT, indices, ranges, base);
+}
+
+/*
+ * Sorts `items` by depth, nearest first, in O(count) with `tmp` (of the same size) to spare: a least significant
+ * digit radix sort on the bits of the depths, which order like unsigned integers as long as they aren't negative.
+ * The bytes all the depths share are skipped, usually the top one.
+ */
+static void sort_depths (struct mc_ChunkDepth * items, struct mc_ChunkDepth * tmp, size_t count) {
+    if (count == 0)
+        return;
+    assert(items != NULL);
+    assert(tmp != NULL);
+    uint32_t counts[4][256] = {{0}};
+    for (size_t i = 0; i < count; i++) {
+        uint32_t key;
+        assert(items[i].depth >= 0.0f);
+        memcpy(&key, &items[i].depth, sizeof(key));
+        for (int d = 0; d < 4; d++)
+            counts[d][(key >> (d * 8)) & 255]++;
+    }
+    struct mc_ChunkDepth * src = items, * dst = tmp;
+    for (int d = 0; d < 4; d++) {
+        uint32_t pos = 0, first;
+        memcpy(&first, &src[0].depth, sizeof(first));
+        if (counts[d][(first >> (d * 8)) & 255] == count)
+            continue;
+        for (int b = 0; b < 256; b++) {
+            uint32_t n = counts[d][b];
+            counts[d][b] = pos;
+            pos += n;
+        }
+        for (size_t i = 0; i < count; i++) {
+            uint32_t key;
+            memcpy(&key, &src[i].depth, sizeof(key));
+            dst[counts[d][(key >> (d * 8)) & 255]++] = src[i];
+        }
+        struct mc_ChunkDepth * t = src;
+        src = dst;
+        dst = t;
+    }
+    if (src != items)
+        memcpy(items, src, sizeof(*items) * count);
+}
+
+// the squared distance from `eye` (in blocks) to the nearest point of `chunk`, 0 inside it
+static float chunk_depth (const struct mc_Chunk * chunk, vec3 eye) {
+    assert(chunk != NULL);
+    float d2 = 0.0f;
+    for (int a = 0; a < 3; a++) {
+        float lo = (float)(chunk->pos[a] * MC_CHUNK_SIZE);
+        float d = MC_MAX(0.0f, MC_MAX(lo - eye[a], eye[a] - (lo + MC_CHUNK_SIZE)));
+        d2 += d * d;
+    }
+    return d2;
+}
+
+/*
+ * Orders wd->draw_list front to back from `eye`, so that the depth test throws away as many of the fragments
+ * of the farther chunks as it can before they're shaded (see mc_WorldCullStats.samples).
+ */
+static void sort_front_to_back (struct mc_World * wd, vec3 eye) {
+    assert(wd != NULL);
+    struct mc_ChunkDepth * items = wd->draw_depths, * tmp = &wd->draw_depths[wd->draw_cap];
+    for (size_t i = 0; i < wd->draw_count; i++)
+        items[i] = (struct mc_ChunkDepth){.depth = chunk_depth(wd->draw_list[i], eye), .chunk = wd->draw_list[i]};
+    sort_depths(items, tmp, wd->draw_count);
+    for (size_t i = 0; i < wd->draw_count; i++)
+        wd->draw_list[i] = items[i].chunk;
+}
+
+/*
+ * Starts counting the samples that pass the depth test, in the query of this frame, whose last count is picked up
+ * first if the GPU has it by now. The count of a frame gets to wd->cull_stats.samples MC_WORLD_SAMPLE_QUERIES later.
+ */
+static void begin_samples (struct mc_World * wd) {
+    assert(wd != NULL);
+    GLuint query = wd->sample_queries[wd->sample_frames % MC_WORLD_SAMPLE_QUERIES];
+    if (wd->sample_frames >= MC_WORLD_SAMPLE_QUERIES) {
+        GLuint available = GL_FALSE;
+        glGetQueryObjectuiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (available) {
+            GLuint samples = 0;
+            glGetQueryObjectuiv(query, GL_QUERY_RESULT, &samples);
+            wd->cull_stats.samples = samples;
+        }
+    }
+    wd->sample_frames++;
+    glBeginQuery(GL_SAMPLES_PASSED, query);
+}
+
+// the chunks of wd->draw_list with translucent faces into wd->translucent, the nearest to `eye` first
+static void sort_translucent (struct mc_World * wd, vec3 eye) {
+    assert(wd != NULL);
+    if (wd->translucent_cap < wd->draw_cap) {
+        wd->translucent_cap = wd->draw_cap;
+        wd->translucent = realloc(wd->translucent, sizeof(*wd->translucent) * wd->translucent_cap * 2);
+        assert(wd->translucent != NULL);
+    }
+    wd->translucent_count = 0;
+    for (size_t i = 0; i < wd->draw_count; i++) {
+        struct mc_Chunk * chunk = wd->draw_list[i];
+        if (chunk->mesh_translucent == 0)
+            continue;
+        vec3 centre;
+        for (int a = 0; a < 3; a++)
+            centre[a] = (chunk->pos[a] + 0.5f) * MC_CHUNK_SIZE;
+        wd->translucent[wd->translucent_count++] = (struct mc_ChunkDepth){.depth = glm_vec3_distance2(centre, eye), .chunk = chunk};
+    }
+    sort_depths(wd->translucent, &wd->translucent[wd->translucent_cap], wd->translucent_count);
 }
 
 /*============================================================================================================
@@ -154,56 +743,115 @@ static void send_block (struct mc_World * wd, struct mc_Block * block, float x_,
  * 
  *==========================================================================================================*/
 
-void mc_world_init (struct mc_World *wd, size_t reserved_blocks_count) {
+void mc_world_init (struct mc_World *wd, size_t reserved_blocks_count, struct mc_UploadRing * upload) {
     assert(wd != NULL);
+    assert(upload != NULL);
 
     wd->offset[0] = 0;
     wd->offset[1] = 0;
     wd->offset[2] = 0;
     wd->fnl = fnlCreateState();
     wd->fnl.noise_type = FNL_NOISE_PERLIN;
-    wd->blocks = malloc(sizeof(*wd->blocks) * MC_WORLD_MAX_BLOCKS);
+    mc_chunkmap_init(&wd->chunks);
+    mc_stream_init(&wd->stream, &wd->fnl);
+    wd->following = MC_FALSE;
+    wd->greedy = MC_FALSE;
+    wd->pulling = MC_FALSE;
+    wd->faces_count = 0;
+    wd->versions = 0;
+    wd->upload = upload;
+    wd->upload_bytes = 0;
+    wd->shadow = NULL;
+    wd->shadow_valid = 0;
+    wd->dirty_ranges = NULL;
+    wd->dirty_ranges_count = 0;
+    wd->dirty_ranges_cap = 0;
+    memset(&wd->upload_stats, 0, sizeof(wd->upload_stats));
+    wd->draw_list = NULL;
+    wd->draw_count = 0;
+    wd->draw_cap = 0;
+    wd->draw_boxes = NULL;
+    wd->draw_visible = NULL;
+    wd->draw_depths = NULL;
+    wd->front_to_back = MC_TRUE;
+    mc_occlusion_init(&wd->occlusion);
+    wd->visits = NULL;
+    wd->visits_cap = 0;
+    wd->draws = 0;
+    wd->translucent = NULL;
+    wd->translucent_count = 0;
+    wd->translucent_cap = 0;
+    memset(&wd->cull_stats, 0, sizeof(wd->cull_stats));
+    wd->indicator = MC_BLOCK_TYPE_NONE;
+    wd->indicator_pos[0] = 0;
+    wd->indicator_pos[1] = 0;
+    wd->indicator_pos[2] = 0;
+    wd->indicator_written = MC_BLOCK_TYPE_NONE;
     
-    wd->face_indices_top = reserved_blocks_count;
-    wd->free_face_indices_top = 0;
-    wd->free_face_indices = malloc(sizeof(*wd->free_face_indices) * MC_WORLD_MAX_FACES);
-
-    for (int ix = 0; ix < MC_RENDER_DISTANCE; ix++)
-    for (int iy = 0; iy < MC_WORLD_HEIGHT;    iy++)
-    for (int iz = 0; iz < MC_RENDER_DISTANCE; iz++) {
-        struct mc_Block * block = block_at_idx(wd, ix, iy, iz);
-        block->exists = MC_FALSE;
-        block->face_idx_left = 0;
-        block->face_idx_right = 0;
-        block->face_idx_top = 0;
-        block->face_idx_bottom = 0;
-        block->face_idx_front = 0;
-        block->face_idx_back = 0;
-        block->type = MC_BLOCK_TYPE_GRASS;
-    }
+    mc_mesh_init(&wd->mesh);
+    mc_slots_init(&wd->slots);
 
+    // starts small, see grow_vbo and shrink_vbo
 	glGenVertexArrays(1, &wd->VAO);
-	glBindVertexArray(wd->VAO);
+    glGenTextures(1, &wd->faces_tex);
+    glGenQueries(MC_WORLD_SAMPLE_QUERIES, wd->sample_queries);
+    wd->sample_frames = 0;
+    wd->VBO = 0;
+    wd->vbo_size = 0;
+    wd->vbo_resizes = 0;
+    resize_vbo(wd, MC_WORLD_MIN_VBO_SIZE);
 
-	glGenBuffers(1, &wd->VBO);
-	glBindBuffer(GL_ARRAY_BUFFER, wd->VBO);
-	glBufferData(GL_ARRAY_BUFFER, MC_WORLD_MAX_VERTICES * sizeof(GLfloat), NULL, GL_DYNAMIC_DRAW);
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(struct mc_BlockVertex), offsetof(struct mc_BlockVertex, x));
-	glEnableVertexAttribArray(1);
-	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(struct mc_BlockVertex), offsetof(struct mc_BlockVertex, tx));
-	glEnableVertexAttribArray(2);
-	glVertexAttribPointer(2, 1, GL_FLOAT, GL_FALSE, sizeof(struct mc_BlockVertex), offsetof(struct mc_BlockVertex, a));
+    // the faces before are left to the caller
+    if (reserved_blocks_count > 0)
+        alloc_faces(wd, reserved_blocks_count * MC_BLOCK_FACES);
+    wd->indicator_first = alloc_faces(wd, MC_BLOCK_FACES);
+
+    // every chunk is drawn with the same indices, glDrawElementsBaseVertex offsets them to the chunk's range
+    GLuint * indices = malloc(sizeof(*indices) * MC_CHUNK_MAX_FACES * MC_BLOCK_FACE_INDICES);
+    assert(indices != NULL);
+    for (GLuint i = 0; i < MC_CHUNK_MAX_FACES; i++) {
+        static const GLuint quad[MC_BLOCK_FACE_INDICES] = {0, 1, 2, 2, 3, 0};
+        for (int j = 0; j < MC_BLOCK_FACE_INDICES; j++)
+            indices[i * MC_BLOCK_FACE_INDICES + j] = i * MC_BLOCK_FACE_VERTICES + quad[j];
+    }
+	glGenBuffers(1, &wd->EBO);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, wd->EBO);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(*indices) * MC_CHUNK_MAX_FACES * MC_BLOCK_FACE_INDICES, indices, GL_STATIC_DRAW);
+    free(indices);
+
+    // same indices, gl_VertexID / MC_BLOCK_FACE_VERTICES is then the face slot
+	glGenVertexArrays(1, &wd->pull_VAO);
+	glBindVertexArray(wd->pull_VAO);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, wd->EBO);
 }
 
 void mc_world_free (struct mc_World *wd) {
     assert(wd != NULL);
 
-    free(wd->blocks);
-    free(wd->free_face_indices);
+    mc_stream_free(&wd->stream);
+
+    for (size_t i = 0; i < wd->chunks.cap; i++)
+        if (wd->chunks.entries[i] != NULL)
+            mc_chunk_destroy(wd->chunks.entries[i]);
+    mc_chunkmap_free(&wd->chunks);
+    mc_slots_free(&wd->slots);
+    free(wd->shadow);
+    free(wd->dirty_ranges);
+    free(wd->draw_list);
+    free(wd->draw_boxes);
+    free(wd->draw_visible);
+    free(wd->draw_depths);
+    mc_occlusion_free(&wd->occlusion);
+    free(wd->visits);
+    free(wd->translucent);
+    mc_mesh_free(&wd->mesh);
 
 	glDeleteVertexArrays(1, &wd->VAO);
+	glDeleteVertexArrays(1, &wd->pull_VAO);
+	glDeleteTextures(1, &wd->faces_tex);
+    glDeleteQueries(MC_WORLD_SAMPLE_QUERIES, wd->sample_queries);
 	glDeleteBuffers(1, &wd->VBO);
+	glDeleteBuffers(1, &wd->EBO);
 }
 
 /*============================================================================================================
@@ -212,203 +860,338 @@ void mc_world_free (struct mc_World *wd) {
  * 
  *==========================================================================================================*/
 
-void mc_world_draw (struct mc_World * wd, GLint blocks_index, GLsizei blocks_count) {
+/*
+ * Sends what mc_world_update wrote since the last frame, then draws the range of every chunk that may be seen
+ * through `viewproj` (proj * view) from `eye` (in blocks) with `prog`, less the faces turned away from `eye`.
+ * The opaque faces are drawn without blending, the translucent ones after them, GL_BLEND is left disabled.
+ * The vertex positions are relative to the chunk, its origin (in blocks) goes to the uniform `origin`.
+ */
+void mc_world_draw (struct mc_World * wd, GLuint prog, mat4 viewproj, vec3 eye) {
     assert(wd != NULL);
-    assert(blocks_count > 0);
-	glBindVertexArray(wd->VAO);
-	glDrawArrays(GL_TRIANGLES, blocks_index * MC_BLOCK_VERTICES, blocks_count * MC_BLOCK_VERTICES);
+    assert(viewproj != NULL);
+    assert(eye != NULL);
+    upload_indicator(wd);
+    flush_shadow(wd);
+    wd->upload_bytes = 0;
+    compact_faces(wd);
+    shrink_vbo(wd);
+    gather_chunks(wd, eye);
+    cull_frustum(wd, viewproj);
+    cull_occlusion(wd, viewproj, eye);
+
+    GLint origin_uniform = glGetUniformLocation(prog, "origin");
+    glUniform1i(glGetUniformLocation(prog, "pulling"), wd->pulling);
+    if (wd->pulling) {
+        glActiveTexture(GL_TEXTURE0 + MC_WORLD_FACES_TEXTURE_UNIT);
+        glBindTexture(GL_TEXTURE_BUFFER, wd->faces_tex);
+        glBindVertexArray(wd->pull_VAO);
+    }
+    else
+        glBindVertexArray(wd->VAO);
+    wd->cull_stats.drawn = wd->draw_count;
+    wd->cull_stats.drawn_faces = 0;
+    wd->cull_stats.facing_away = 0;
+
+    // opaque faces first, the nearest chunks before the ones they may hide
+    if (wd->front_to_back)
+        sort_front_to_back(wd, eye);
+    glDisable(GL_BLEND);
+    glDepthMask(GL_TRUE);
+    begin_samples(wd);
+    for (size_t i = 0; i < wd->draw_count; i++) {
+        struct mc_Chunk * chunk = wd->draw_list[i];
+        glUniform3i(origin_uniform, chunk->pos[0] * MC_CHUNK_SIZE, chunk->pos[1] * MC_CHUNK_SIZE, chunk->pos[2] * MC_CHUNK_SIZE);
+        draw_chunk(wd, chunk, facing_dirs(chunk, eye));
+    }
+    glEndQuery(GL_SAMPLES_PASSED);
+
+    // then the translucent ones blended over them a chunk at a time from back to front, without hiding each other
+    sort_translucent(wd, eye);
+    wd->cull_stats.translucent = wd->translucent_count;
+    if ((wd->translucent_count == 0) && (wd->indicator == MC_BLOCK_TYPE_NONE))
+        return;
+    glEnable(GL_BLEND);
+    glDepthMask(GL_FALSE);
+    for (size_t i = wd->translucent_count; i-- > 0;) {
+        struct mc_Chunk * chunk = wd->translucent[i].chunk;
+        glUniform3i(origin_uniform, chunk->pos[0] * MC_CHUNK_SIZE, chunk->pos[1] * MC_CHUNK_SIZE, chunk->pos[2] * MC_CHUNK_SIZE);
+        uint32_t first = chunk->mesh_first + chunk->mesh_faces - chunk->mesh_translucent;
+        glDrawElementsBaseVertex(GL_TRIANGLES, chunk->mesh_translucent * MC_BLOCK_FACE_INDICES, GL_UNSIGNED_INT, NULL, first * MC_BLOCK_FACE_VERTICES);
+        wd->cull_stats.drawn_faces += chunk->mesh_translucent;
+    }
+    if (wd->indicator != MC_BLOCK_TYPE_NONE) {
+        glUniform3i(origin_uniform, wd->indicator_pos[0], wd->indicator_pos[1], wd->indicator_pos[2]);
+        glDrawElementsBaseVertex(GL_TRIANGLES, MC_BLOCK_FACES * MC_BLOCK_FACE_INDICES, GL_UNSIGNED_INT, NULL, wd->indicator_first * MC_BLOCK_FACE_VERTICES);
+        wd->cull_stats.drawn_faces += MC_BLOCK_FACES;
+    }
+    glDepthMask(GL_TRUE);
+    glDisable(GL_BLEND);
+}
+
+size_t mc_world_blocks_memory (struct mc_World * wd) {
+    assert(wd != NULL);
+    size_t mem = 0;
+    for (size_t i = 0; i < wd->chunks.cap; i++)
+        if (wd->chunks.entries[i] != NULL)
+            mem += mc_chunk_memory(wd->chunks.entries[i]);
+    return mem;
 }
 
-struct mc_Block * mc_world_block_at (struct mc_World * wd, int x, int y, int z) {
+// the CPU side faces and vertices the chunks are meshed into before they're uploaded, and the shadow buffer
+size_t mc_world_mesh_memory (struct mc_World * wd) {
     assert(wd != NULL);
-    int ix, iy, iz;
-    if (!coord_to_idx(wd, x, y, z, &ix, &iy, &iz))
-        return NULL;
-    struct mc_Block * block = block_at_idx(wd, ix, iy, iz);
-    if (!block->exists)
-        return NULL;
-    return block;
+    return wd->mesh.cap * sizeof(struct mc_FaceRecord) + wd->mesh.vertices_cap * MC_BLOCK_FACE_VERTICES * sizeof(struct mc_BlockVertex) + wd->vbo_size;
+}
+
+// the size of the VBO
+size_t mc_world_vertices_memory (struct mc_World * wd) {
+    assert(wd != NULL);
+    return wd->vbo_size;
+}
+
+// the part of the VBO up to the last range in use
+size_t mc_world_vertices_used (struct mc_World * wd) {
+    assert(wd != NULL);
+    return (size_t)wd->slots.top * face_size(wd);
+}
+
+// returns MC_BLOCK_TYPE_NONE if there's no block at (x, y, z) or its chunk isn't loaded
+mc_BlockID mc_world_block_at (struct mc_World * wd, int x, int y, int z) {
+    assert(wd != NULL);
+    struct mc_Chunk * chunk = mc_world_chunk_at(wd, block_to_chunk(x), block_to_chunk(y), block_to_chunk(z));
+    if (chunk == NULL)
+        return MC_BLOCK_TYPE_NONE;
+    return mc_chunk_get(chunk, mc_chunk_idx(block_to_local(x), block_to_local(y), block_to_local(z)));
+}
+
+MC_BOOL mc_world_is_occupied (struct mc_World * wd, int x, int y, int z) {
+    assert(wd != NULL);
+    struct mc_Chunk * chunk = mc_world_chunk_at(wd, block_to_chunk(x), block_to_chunk(y), block_to_chunk(z));
+    if (chunk == NULL)
+        return MC_FALSE;
+    return mc_chunk_is_occupied(chunk, block_to_local(x), block_to_local(y), block_to_local(z));
+}
+
+static void set_block_at (struct mc_World * wd, int x, int y, int z, mc_BlockID type) {
+    assert(wd != NULL);
+    struct mc_Chunk * chunk = mc_world_chunk_at(wd, block_to_chunk(x), block_to_chunk(y), block_to_chunk(z));
+    if (chunk == NULL)
+        return;
+    int lx = block_to_local(x);
+    int ly = block_to_local(y);
+    int lz = block_to_local(z);
+    mc_chunk_set(chunk, mc_chunk_idx(lx, ly, lz), type);
+
+    dirty_chunk(wd, chunk);
+    // the faces of the neighbouring chunks only change for blocks on the sides
+    for (int f = 0; f < MC_BLOCK_FACES; f++) {
+        if (is_local_in_chunk(lx + face_dirs[f][0], ly + face_dirs[f][1], lz + face_dirs[f][2]))
+            continue;
+        struct mc_Chunk * neighbour = neighbour_at(wd, chunk, f);
+        if (neighbour != NULL)
+            dirty_chunk(wd, neighbour);
+    }
 }
 
 void mc_world_place_block_at (struct mc_World * wd, int x, int y, int z, enum mc_BlockType type) {
     assert(wd != NULL);
-    int ix, iy, iz;
-    if (coord_to_idx(wd, x, y, z, &ix, &iy, &iz))
-        mc_world_place_block_at_idx(wd, ix, iy, iz, x, y, z, type);
+    assert(MC_BLOCK_EXISTS(type));
+    if (!MC_BLOCK_EXISTS(mc_world_block_at(wd, x, y, z)))
+        set_block_at(wd, x, y, z, type);
 }
 
 void mc_world_destroy_block_at (struct mc_World * wd, int x, int y, int z) {
     assert(wd != NULL);
-    int ix, iy, iz;
-    if (coord_to_idx(wd, x, y, z, &ix, &iy, &iz))
-        mc_world_destroy_block_at_idx(wd, ix, iy, iz, x, y, z);
+    if (MC_BLOCK_EXISTS(mc_world_block_at(wd, x, y, z)))
+        set_block_at(wd, x, y, z, MC_BLOCK_TYPE_NONE);
+}
+
+static const int window_size[3] = {MC_WORLD_CHUNKS_XZ, MC_WORLD_CHUNKS_Y, MC_WORLD_CHUNKS_XZ};
+
+static inline MC_BOOL is_in_window (const int origin[3], int cx, int cy, int cz) {
+    return (cx >= origin[0]) && (cx < origin[0] + window_size[0])
+        && (cy >= origin[1]) && (cy < origin[1] + window_size[1])
+        && (cz >= origin[2]) && (cz < origin[2] + window_size[2]);
 }
 
+/*
+ * Shifts the window of loaded chunks by (dx, dy, dz) chunks.
+ * The chunks that leave the window are unloaded right away, the missing ones are requested from the stream
+ * and show up in mc_world_update.
+ */
 void mc_world_move (struct mc_World * wd, int dx, int dy, int dz) {
     assert(wd != NULL);
-    assert((dx != 0) || (dy != 0) || (dz != 0));
-
-    int ox = wd->offset[0];
-    int oy = wd->offset[1];
-    int oz = wd->offset[2];
-    wd->offset[0]++;
-
-    for (int iz = 0; iz < MC_RENDER_DISTANCE; iz++)
-    for (int iy = 0; iy < MC_WORLD_HEIGHT; iy++) {
-        int y = iy + oy;
-        int z = iz + oz;
-        int ix = ox % MC_RENDER_DISTANCE;
-        if (block_at_idx(wd, ix, iy, iz)->exists) {
-            // mc_save_block(wd, ox, y, z, MC_BLOCK_TYPE_GRASS);
-            mc_world_destroy_block_at_idx(wd,
-                ix, iy, iz,
-                ox, y, z
-            );
+
+    int old_origin[3];
+    int new_origin[3];
+    int d[3] = {dx, dy, dz};
+    for (int i = 0; i < 3; i++) {
+        old_origin[i] = block_to_chunk(wd->offset[i]);
+        new_origin[i] = old_origin[i] + d[i];
+        wd->offset[i] = new_origin[i] * MC_CHUNK_SIZE;
+    }
+
+    for (int cx = old_origin[0]; cx < old_origin[0] + window_size[0]; cx++)
+    for (int cz = old_origin[2]; cz < old_origin[2] + window_size[2]; cz++)
+    for (int cy = old_origin[1]; cy < old_origin[1] + window_size[1]; cy++) {
+        if (is_in_window(new_origin, cx, cy, cz))
+            continue;
+        struct mc_Chunk * chunk = mc_world_chunk_at(wd, cx, cy, cz);
+        if (chunk != NULL)
+            mc_world_unload_chunk(wd, chunk);
+    }
+
+    mc_stream_cancel(&wd->stream, new_origin, window_size);
+    for (int cx = new_origin[0]; cx < new_origin[0] + window_size[0]; cx++)
+    for (int cz = new_origin[2]; cz < new_origin[2] + window_size[2]; cz++)
+    for (int cy = new_origin[1]; cy < new_origin[1] + window_size[1]; cy++)
+        if (mc_world_chunk_at(wd, cx, cy, cz) == NULL)
+            mc_stream_request(&wd->stream, cx, cy, cz, borders_at(wd, cx, cy, cz), wd->greedy);
+}
+
+/*
+ * Keeps the camera inside the window, `eye` is in blocks and `velocity` in blocks per second.
+ * Everything works with where the camera will be MC_STREAM_PREFETCH seconds from now,
+ * so the chunks ahead of it start loading early.
+ * The window is recentered only once that point leaves the middle half of it along some axis,
+ * so moving back and forth over a chunk border doesn't reload anything.
+ */
+void mc_world_follow (struct mc_World * wd, vec3 eye, vec3 front, vec3 velocity) {
+    assert(wd != NULL);
+
+    vec3 ahead;
+    glm_vec3_copy(eye, ahead);
+    glm_vec3_muladds(velocity, MC_STREAM_PREFETCH, ahead);
+    mc_stream_set_view(&wd->stream, ahead, front);
+
+    int d[3] = {0, 0, 0};
+    MC_BOOL moved = MC_FALSE;
+    for (int i = 0; i < 3; i++) {
+        int c = block_to_chunk((int)floorf(ahead[i]));
+        int origin = block_to_chunk(wd->offset[i]);
+        int margin = window_size[i] / 4;
+        if (!wd->following || (c < origin + margin) || (c >= origin + window_size[i] - margin)) {
+            d[i] = (c - window_size[i] / 2) - origin;
+            moved = MC_TRUE;
         }
     }
+    if (moved)
+        mc_world_move(wd, d[0], d[1], d[2]);
+    wd->following = MC_TRUE;
+}
 
-    for (int iz = 0; iz < MC_RENDER_DISTANCE; iz++)
-    for (int iy = 0; iy < MC_WORLD_HEIGHT; iy++) {
-        int y = iy + oy;
-        int z = iz + oz;
-        int ix = ox % MC_RENDER_DISTANCE;
-        int x = MC_RENDER_DISTANCE + ox;
-
-        // enum mc_BlockType type = mc_load_block(wd, x, y, z);
-        // if (type == MC_BLOCK_TYPE_AIR)
-        //     continue;
-        // if (type == MC_BLOCK_TYPE_NONE) {
-            float noise = fnlGetNoise3D(&wd->fnl, x, y, z);
-            if (noise > 0) {
-                mc_world_place_block_at_idx(wd,
-                    ix, iy, iz,
-                    x, y, z, MC_BLOCK_TYPE_GRASS
-                );
-            }
-        // }
-        // else {
-        //     mc_world_place_block_at_idx(wd,
-        //         ix, iy, iz,
-        //         x, y, z, type
-        //     );
-        // }
+/*
+ * Adds up to `max_chunks` chunks the stream has finished and the meshes of the chunks that changed, as long as
+ * they fit into MC_WORLD_UPLOAD_BUDGET, the chunks that have left the window meanwhile are dropped.
+ * Then the chunks that changed since are handed to the stream, everything written is sent with the next draw.
+ */
+void mc_world_update (struct mc_World * wd, size_t max_chunks) {
+    assert(wd != NULL);
+    int origin[3] = {block_to_chunk(wd->offset[0]), block_to_chunk(wd->offset[1]), block_to_chunk(wd->offset[2])};
+    struct mc_StreamJob job;
+    for (size_t added = 0; (added < max_chunks) && (wd->upload_bytes < MC_WORLD_UPLOAD_BUDGET) && mc_stream_pop(&wd->stream, &job);) {
+        if (job.kind == MC_STREAM_JOB_MESH)
+            install_mesh(wd, &job);
+        else if (is_in_window(origin, job.pos[0], job.pos[1], job.pos[2]) && (mc_world_chunk_at(wd, job.pos[0], job.pos[1], job.pos[2]) == NULL)) {
+            install_chunk(wd, &job);
+            added++;
+        }
+        mc_stream_release(&job);
     }
+    mesh_dirty_chunks(wd);
 }
 
 /*============================================================================================================
  *
- * 
+ * Chunks
  * 
  *==========================================================================================================*/
 
-void mc_world_place_block_at_idx (struct mc_World * wd, int ix, int iy, int iz, int x, int y, int z, enum mc_BlockType type) {
-    assert(wd != NULL);
-    assert(is_idx_in_render_distance(ix, iy, iz));
-
-    struct mc_Block * block = block_at_idx(wd, ix, iy, iz);
-    assert(!block->exists);
-    block->type = type;
-    block->exists = MC_TRUE;
-
-    struct mc_Block * block_left  = mc_world_block_at(wd, x - 1, y, z);
-    struct mc_Block * block_right = mc_world_block_at(wd, x + 1, y, z);
-    struct mc_Block * block_bot   = mc_world_block_at(wd, x, y - 1, z);
-    struct mc_Block * block_top   = mc_world_block_at(wd, x, y + 1, z);
-    struct mc_Block * block_back  = mc_world_block_at(wd, x, y, z - 1);
-    struct mc_Block * block_front = mc_world_block_at(wd, x, y, z + 1);
-
-    if (block_left != NULL)
-    if (block_left->face_idx_right != 0) {
-        free_face_index(wd, block_left->face_idx_right);
-        block_left->face_idx_right = 0;
-    }
-    if (block_right != NULL)
-    if (block_right->face_idx_left != 0) {
-        free_face_index(wd, block_right->face_idx_left);
-        block_right->face_idx_left = 0;
-    }
-    if (block_bot != NULL)
-    if (block_bot->face_idx_top != 0) {
-        free_face_index(wd, block_bot->face_idx_top);
-        block_bot->face_idx_top = 0;
-    }
-    if (block_top != NULL)
-    if (block_top->face_idx_bottom != 0) {
-        free_face_index(wd, block_top->face_idx_bottom);
-        block_top->face_idx_bottom = 0;
-    }
-    if (block_back != NULL)
-    if (block_back->face_idx_front != 0) {
-        free_face_index(wd, block_back->face_idx_front);
-        block_back->face_idx_front = 0;
-    }
-    if (block_front != NULL)
-    if (block_front->face_idx_back != 0) {
-        free_face_index(wd, block_front->face_idx_back);
-        block_front->face_idx_back = 0;
-    }
-
-    if (block_left  == NULL) block->face_idx_left   = next_face_index(wd);
-    if (block_right == NULL) block->face_idx_right  = next_face_index(wd);
-    if (block_bot   == NULL) block->face_idx_bottom = next_face_index(wd);
-    if (block_top   == NULL) block->face_idx_top    = next_face_index(wd);
-    if (block_back  == NULL) block->face_idx_back   = next_face_index(wd);
-    if (block_front == NULL) block->face_idx_front  = next_face_index(wd);
-
-    send_block(wd, block, x, y, z, 1,1,1,1,1,1);
-}
-
-void mc_world_destroy_block_at_idx (struct mc_World *wd, int ix, int iy, int iz, int x, int y, int z) {
-    assert(wd != NULL);
-    assert(is_idx_in_render_distance(ix, iy, iz));
-
-    struct mc_Block *block = block_at_idx(wd, ix, iy, iz);
-    assert(block->exists);
-    block->exists = MC_FALSE;
-
-    send_block(wd, block, 0, 0, 0, 0,0,0,0,0,0);
-    if (block->face_idx_back   != 0) free_face_index(wd, block->face_idx_back);
-    if (block->face_idx_front  != 0) free_face_index(wd, block->face_idx_front);
-    if (block->face_idx_left   != 0) free_face_index(wd, block->face_idx_left);
-    if (block->face_idx_right  != 0) free_face_index(wd, block->face_idx_right);
-    if (block->face_idx_top    != 0) free_face_index(wd, block->face_idx_top);
-    if (block->face_idx_bottom != 0) free_face_index(wd, block->face_idx_bottom);
-    block->face_idx_back   = 0;
-    block->face_idx_front  = 0;
-    block->face_idx_left   = 0;
-    block->face_idx_right  = 0;
-    block->face_idx_top    = 0;
-    block->face_idx_bottom = 0;
-
-    struct mc_Block * block_left  = mc_world_block_at(wd, x - 1, y, z);
-    struct mc_Block * block_right = mc_world_block_at(wd, x + 1, y, z);
-    struct mc_Block * block_bot   = mc_world_block_at(wd, x, y - 1, z);
-    struct mc_Block * block_top   = mc_world_block_at(wd, x, y + 1, z);
-    struct mc_Block * block_back  = mc_world_block_at(wd, x, y, z - 1);
-    struct mc_Block * block_front = mc_world_block_at(wd, x, y, z + 1);
-
-    if (block_left != NULL) {
-        block_left->face_idx_right = next_face_index(wd);
-        send_block(wd, block_left, x - 1, y, z, 1,1,1,1,1,1);
-    }
-    if (block_right != NULL) {
-        block_right->face_idx_left = next_face_index(wd);
-        send_block(wd, block_right, x + 1, y, z, 1,1,1,1,1,1);
-    }
-    if (block_bot != NULL) {
-        block_bot->face_idx_top = next_face_index(wd);
-        send_block(wd, block_bot, x, y - 1, z, 1,1,1,1,1,1);
-    }
-    if (block_top != NULL) {
-        block_top->face_idx_bottom = next_face_index(wd);
-        send_block(wd, block_top, x, y + 1, z, 1,1,1,1,1,1);
-    }
-    if (block_back != NULL) {
-        block_back->face_idx_front = next_face_index(wd);
-        send_block(wd, block_back, x, y, z - 1, 1,1,1,1,1,1);
-    }
-    if (block_front != NULL) {
-        block_front->face_idx_back = next_face_index(wd);
-        send_block(wd, block_front, x, y, z + 1, 1,1,1,1,1,1);
-    }
-}
\ No newline at end of file
+struct mc_Chunk * mc_world_chunk_at (struct mc_World * wd, int cx, int cy, int cz) {
+    assert(wd != NULL);
+    return mc_chunkmap_get(&wd->chunks, cx, cy, cz);
+}
+
+// generates and meshes the chunk right away, on the calling thread
+struct mc_Chunk * mc_world_load_chunk (struct mc_World * wd, int cx, int cy, int cz) {
+    assert(wd != NULL);
+    assert(mc_world_chunk_at(wd, cx, cy, cz) == NULL);
+
+    struct mc_StreamJob job = {
+        .kind = MC_STREAM_JOB_GENERATE, .pos = {cx, cy, cz}, .borders = borders_at(wd, cx, cy, cz), .greedy = wd->greedy
+    };
+    mc_mesh_init(&job.mesh);
+    mc_stream_build(&wd->fnl, &job, &wd->mesh);
+    struct mc_Chunk * chunk = install_chunk(wd, &job);
+    mc_stream_release(&job);
+    return chunk;
+}
+
+void mc_world_unload_chunk (struct mc_World * wd, struct mc_Chunk * chunk) {
+    assert(wd != NULL);
+    assert(chunk != NULL);
+
+    mc_chunkmap_remove(&wd->chunks, chunk);
+    free_chunk_faces(wd, chunk);
+    mark_neighbours_dirty(wd, chunk);
+    mc_chunk_destroy(chunk);
+}
+
+// meshes the chunk right away on the calling thread, it's sent with the next draw
+void mc_world_mesh_chunk (struct mc_World * wd, struct mc_Chunk * chunk) {
+    assert(wd != NULL);
+    assert(chunk != NULL);
+    struct mc_ChunkBorders * borders = borders_at(wd, chunk->pos[0], chunk->pos[1], chunk->pos[2]);
+    mc_mesh_build(&wd->mesh, chunk, borders, wd->greedy);
+    free(borders);
+    dirty_chunk(wd, chunk); // drops the meshes being built
+    chunk->dirty = MC_FALSE;
+    chunk->solid_cells = mc_chunk_solid_cells(chunk);
+    mc_chunk_face_links(chunk, chunk->links);
+    upload_chunk(wd, chunk, &wd->mesh);
+}
+
+// switches between a face per block face and greedy meshing, every chunk is meshed again (see mc_world_update)
+void mc_world_set_greedy (struct mc_World * wd, MC_BOOL greedy) {
+    assert(wd != NULL);
+    if (wd->greedy == greedy)
+        return;
+    wd->greedy = greedy;
+    for (size_t i = 0; i < wd->chunks.cap; i++)
+        if (wd->chunks.entries[i] != NULL)
+            dirty_chunk(wd, wd->chunks.entries[i]);
+}
+
+/*
+ * Switches between sending 4 vertices per face and sending the face records as they are,
+ * which the vertex shader expands using gl_VertexID, every chunk is meshed and uploaded again (see mc_world_update).
+ * The face slots change size, so the chunks give up their ranges and aren't drawn until then.
+ */
+void mc_world_set_pulling (struct mc_World * wd, MC_BOOL pulling) {
+    assert(wd != NULL);
+    if (wd->pulling == pulling)
+        return;
+    flush_shadow(wd); // the dirty ranges are in faces of the current size
+    wd->pulling = pulling;
+    wd->indicator_written = MC_BLOCK_TYPE_NONE;
+    for (size_t i = 0; i < wd->chunks.cap; i++) {
+        struct mc_Chunk * chunk = wd->chunks.entries[i];
+        if (chunk != NULL) {
+            free_chunk_faces(wd, chunk);
+            dirty_chunk(wd, chunk);
+        }
+    }
+}
+
+/*
+ * Draws a block of `type` at x, y, z (in blocks) see-through on top of the world from the next draw on,
+ * MC_BLOCK_TYPE_NONE hides it. It has face slots of its own, the world's blocks aren't changed.
+ */
+void mc_world_set_indicator (struct mc_World * wd, int x, int y, int z, mc_BlockID type) {
+    assert(wd != NULL);
+    assert((type == MC_BLOCK_TYPE_NONE) || MC_BLOCK_EXISTS(type));
+    wd->indicator = type;
+    wd->indicator_pos[0] = x;
+    wd->indicator_pos[1] = y;
+    wd->indicator_pos[2] = z;
+}
@@ -0,0 +1,164 @@
+/*
+ *
+ * Checks of the software occlusion culler, headless like the benchmarks
+ * A few fixed scenes around a solid chunk, then random boxes whose "hidden" answers are checked
+ * against rays cast from the eye through the occluders
+ *
+ */
+
+#include "mc.h"
+
+#include <stdlib.h>
+
+#define TEST_SCENES      (300)
+#define TEST_OCCLUDERS   (20) // boxes per random scene
+#define TEST_BOXES       (200) // tested per random scene
+#define TEST_RAYS        (300) // per box found hidden
+
+static int failures = 0;
+
+static void check (MC_BOOL ok, const char * what) {
+    printf("%s: %s\n", ok ? "ok  " : "FAIL", what);
+    failures += !ok;
+}
+
+// the same numbers on every libc
+static uint32_t seed = 5;
+static float rnd (float a, float b) {
+    seed = seed * 1664525u + 1013904223u;
+    return a + (b - a) * (float)(seed >> 8) / (float)(1u << 24);
+}
+
+static void viewproj_towards (vec3 eye, vec3 center, mat4 viewproj) {
+    mat4 proj, view;
+    glm_perspective(glm_rad(MC_FOV), (float)MC_WINDOW_WIDTH / (float)MC_WINDOW_HEIGHT, MC_OCCLUSION_NEAR, 1000.0f, proj);
+    glm_lookat(eye, center, (vec3){0, 1, 0}, view);
+    glm_mat4_mul(proj, view, viewproj);
+}
+
+// whether the segment from `eye` to just short of `p` goes through the box min .. max (slab test)
+static MC_BOOL segment_hits (vec3 eye, vec3 p, const float * min, const float * max) {
+    float t0 = 0.0f, t1 = 0.9999f;
+    for (int a = 0; a < 3; a++) {
+        float d = p[a] - eye[a];
+        if (fabsf(d) < 1e-9f) {
+            if ((eye[a] < min[a]) || (eye[a] > max[a]))
+                return MC_FALSE;
+            continue;
+        }
+        float u = (min[a] - eye[a]) / d, v = (max[a] - eye[a]) / d;
+        t0 = MC_MAX(t0, MC_MIN(u, v));
+        t1 = MC_MIN(t1, MC_MAX(u, v));
+        if (t0 > t1)
+            return MC_FALSE;
+    }
+    return MC_TRUE;
+}
+
+// whether any of the occluders is in the way from `eye` to `p`
+static MC_BOOL blocked (vec3 eye, vec3 p, float (*min)[3], float (*max)[3], int count) {
+    for (int i = 0; i < count; i++)
+        if (segment_hits(eye, p, min[i], max[i]))
+            return MC_TRUE;
+    return MC_FALSE;
+}
+
+/*============================================================================================================
+ *
+ * Tests
+ *
+ *==========================================================================================================*/
+
+// the camera looks down -Z at the middle of a solid chunk from 1.8 units in front of it
+static void test_chunk_wall (struct mc_Occlusion * occ) {
+    static mc_BlockID ids[MC_CHUNK_BLOCKS];
+    for (uint32_t i = 0; i < MC_CHUNK_BLOCKS; i++)
+        ids[i] = MC_BLOCK_TYPE_GRASS;
+    struct mc_Chunk * chunk = mc_chunk_create(0, 0, 0);
+    mc_chunk_fill(chunk, ids);
+    chunk->solid_cells = mc_chunk_solid_cells(chunk);
+
+    const float size = MC_CHUNK_SIZE * MC_BLOCK_SIZE;
+    vec3 eye = {size / 2, size / 2, size + 1.8f};
+    mat4 viewproj;
+    viewproj_towards(eye, (vec3){eye[0], eye[1], 0.0f}, viewproj);
+    mc_occlusion_begin(occ, viewproj, eye);
+    mc_occlusion_add_chunk(occ, chunk);
+    mc_occlusion_finish(occ);
+    check(occ->occluders > 0, "the solid chunk is an occluder");
+
+    check(!mc_occlusion_visible(occ, (vec3){1.2f, 1.2f, -3.0f}, (vec3){2.0f, 2.0f, -2.0f}), "box behind the chunk is hidden");
+    check( mc_occlusion_visible(occ, (vec3){1.2f, 1.2f, 3.6f}, (vec3){2.0f, 2.0f, 4.0f}), "box between the chunk and the eye is visible");
+    check( mc_occlusion_visible(occ, (vec3){eye[0] - 11.0f, 1.2f, -3.0f}, (vec3){eye[0] - 9.0f, 2.0f, -2.0f}), "box beside the chunk is visible");
+    check( mc_occlusion_visible(occ, (vec3){eye[0] - 0.2f, eye[1] - 0.2f, eye[2] - 0.1f}, (vec3){eye[0] + 0.2f, eye[1] + 0.2f, eye[2] + 0.1f}), "box across the near plane is visible");
+
+    // seen from behind the chunk, the same box is in plain sight
+    vec3 back = {size / 2, size / 2, -8.0f};
+    viewproj_towards(back, (vec3){back[0], back[1], 0.0f}, viewproj);
+    mc_occlusion_begin(occ, viewproj, back);
+    mc_occlusion_add_chunk(occ, chunk);
+    mc_occlusion_finish(occ);
+    check( mc_occlusion_visible(occ, (vec3){1.2f, 1.2f, -3.0f}, (vec3){2.0f, 2.0f, -2.0f}), "box in front of the chunk seen from behind it is visible");
+
+    mc_chunk_destroy(chunk);
+}
+
+/*
+ * Random boxes in front of the camera, some random occluders among them. Every box found hidden gets rays cast
+ * from the eye to random points in it, if one of them reaches a point on screen without going through an occluder
+ * the box was wrongly culled, which must never happen.
+ */
+static void test_random_scenes (struct mc_Occlusion * occ) {
+    long hidden = 0, visible = 0, wrong = 0;
+    for (int s = 0; s < TEST_SCENES; s++) {
+        vec3 eye = {0.0f, 0.0f, 0.0f};
+        mat4 viewproj;
+        viewproj_towards(eye, (vec3){rnd(-1.0f, 1.0f), rnd(-0.3f, 0.3f), -1.0f}, viewproj);
+
+        float min[TEST_OCCLUDERS][3], max[TEST_OCCLUDERS][3];
+        mc_occlusion_begin(occ, viewproj, eye);
+        for (int i = 0; i < TEST_OCCLUDERS; i++) {
+            float size = rnd(0.8f, 4.0f);
+            min[i][0] = rnd(-8.0f, 8.0f);
+            min[i][1] = rnd(-3.0f, 3.0f);
+            min[i][2] = rnd(-12.0f, -3.0f);
+            max[i][0] = min[i][0] + size * rnd(0.5f, 2.0f);
+            max[i][1] = min[i][1] + size;
+            max[i][2] = min[i][2] + size * 0.5f;
+            mc_occlusion_add_box(occ, min[i], max[i]);
+        }
+        mc_occlusion_finish(occ);
+
+        for (int b = 0; b < TEST_BOXES; b++) {
+            vec3 bmin = {rnd(-20.0f, 20.0f), rnd(-6.0f, 6.0f), rnd(-40.0f, -4.0f)}, bmax;
+            glm_vec3_adds(bmin, rnd(0.3f, 3.0f), bmax);
+            if (mc_occlusion_visible(occ, bmin, bmax)) {
+                visible++;
+                continue;
+            }
+            hidden++;
+            MC_BOOL seen = MC_FALSE;
+            for (int r = 0; (r < TEST_RAYS) && !seen; r++) {
+                vec3 p = {rnd(bmin[0], bmax[0]), rnd(bmin[1], bmax[1]), rnd(bmin[2], bmax[2])};
+                vec4 clip;
+                glm_mat4_mulv(viewproj, (vec4){p[0], p[1], p[2], 1.0f}, clip);
+                if ((clip[3] <= 0.0f) || (fabsf(clip[0]) > clip[3]) || (fabsf(clip[1]) > clip[3]))
+                    continue;
+                seen = !blocked(eye, p, min, max, TEST_OCCLUDERS);
+            }
+            wrong += seen;
+        }
+    }
+    printf("random scenes: %ld hidden, %ld visible, %ld hidden but seen by a ray\n", hidden, visible, wrong);
+    check(hidden > 0, "random scenes hide some boxes");
+    check(wrong == 0, "random scenes hide no box that can be seen");
+}
+
+int main (void) {
+    static struct mc_Occlusion occ;
+    mc_occlusion_init(&occ);
+    test_chunk_wall(&occ);
+    test_random_scenes(&occ);
+    mc_occlusion_free(&occ);
+    return (failures == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}